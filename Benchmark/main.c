@@ -0,0 +1,759 @@
+/***************************************************************************
+* File:  main.c
+* Author:  SkibbleBip
+* Benchmarks of the hot paths of the dingers: decoding the server's input
+* events, and the client's sample copy, mixing, resampling and format and
+* channel conversion. Inputs come from fixed seeds and the embedded sounds,
+* the process is pinned to one CPU (DINGER_CPU, 0 if unset), and each case
+* reports the median of its rounds in ns per operation and bytes per cycle.
+* With -j the results are printed as one JSON object per line instead of a
+* table, to keep between releases. Build it with optimisations, and with
+* -mavx2 to include the AVX2 scanner; it links with -lasound -lm -pthread but
+* opens no sound device.
+* Procedures:
+* makeSession           -Function that fills a buffer with a synthetic typing
+*                               session
+* decodeTable           -Function that decodes an input event with a lookup
+*                               table instead of the cmpEventVals chain
+* filterChain           -Function that decodes every event with the
+*                               cmpEventVals chain
+* filterTable           -Function that decodes every event with the table
+* filterScalar          -Function that decodes the events the scalar scanner
+*                               finds
+* filterSse2            -Function that decodes the events the SSE2 scanner
+*                               finds
+* filterAvx2            -Function that decodes the events the AVX2 scanner
+*                               finds
+* filterKeys            -Function that decodes the lock changes and key
+*                               presses the scanner finds, in typewriter mode
+* runSession            -Function that runs a filter over the whole session
+* benchChain            -Function that times the cmpEventVals chain
+* benchTable            -Function that times the table decoder
+* benchScalar           -Function that times the scalar scanner
+* benchSse2             -Function that times the SSE2 scanner
+* benchAvx2             -Function that times the AVX2 scanner
+* benchKeys             -Function that times the scanner in typewriter mode
+* benchPlayCopy         -Function that times playSound copying a ding
+* benchMixS16           -Function that times mixing 16 bit samples
+* benchMixS32           -Function that times mixing 32 bit samples
+* benchMixFloat         -Function that times mixing floating point samples
+* benchResample         -Function that times resampling a ding
+* benchS16ToFloat       -Function that times converting samples to floating
+*                               point
+* benchEncodeMono       -Function that times converting samples to 16 bit
+* benchEncodeStereo     -Function that times converting samples to 16 bit
+*                               stereo
+* readCycles            -Function that reads the time stamp counter
+* pinCpu                -Function that pins the benchmark to one CPU
+* setupBench            -Function that prepares the inputs of every case
+* runCase               -Function that times one case and prints the result
+* main                  -The main function
+***************************************************************************/
+
+#define _GNU_SOURCE
+/*for sched_setaffinity*/
+
+#include <sys/file.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <linux/input.h>
+#include <linux/input-event-codes.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../main.h"
+#include "../Server/Keyboard.h"
+#include "../Server/Scan.h"
+#include "../Client/Playback.h"
+#include "../Client/Mixer.h"
+
+#define         SESSION_EVENTS  (1 << 20)
+/*Number of events in the session*/
+#define         BATCH           64
+/*Events per read, the same as the server*/
+#define         ROUNDS          15
+/*How many times each case is timed, the median is reported*/
+#define         SEED            12345
+/*Seed of the session and the mixed samples, so every run sees the same
+* input*/
+#define         MIX_SAMPLES     4096
+/*Samples mixed per operation*/
+#define         PLAYS           64
+/*Dings copied per round*/
+#define         RESAMPLE_RATE   48000
+/*Rate the ding is resampled to*/
+
+
+/*Struct to contain a filter over a batch of input events*/
+typedef struct {
+        const char* name;
+        uint (*filter)(const struct input_event* events, size_t count);
+} Filter;
+
+/*Struct to contain a benchmark case. run does one round and returns a
+* checksum of its results, which is printed so a change that alters the
+* output shows up as well as one that alters the speed*/
+typedef struct {
+        const char* name;
+        uint64_t (*run)(void);
+        uint64_t ops;
+        /*operations per round*/
+        uint64_t bytes;
+        /*bytes of input per round*/
+} Bench_Case;
+
+
+/*Inputs of the cases*/
+struct input_event* g_session;
+Sound_Device g_device;
+int16_t g_mixS16[2][MIX_SAMPLES];
+int32_t g_mixS32[2][MIX_SAMPLES];
+float g_mixFloat[2][MIX_SAMPLES];
+float* g_resampled;
+wavByte_t* g_encoded;
+
+const Status_t g_ledTable[LED_SCROLLL + 1][2] = {
+        [LED_NUML]      = {NUM_OFF, NUM_ON},
+        [LED_CAPSL]     = {CAPS_OFF, CAPS_ON},
+        [LED_SCROLLL]   = {SCROLL_OFF, SCROLL_ON}
+};
+/*The status of each lock LED code and value*/
+
+
+/*Definitions of functions*/
+void makeSession(struct input_event* events, size_t count);
+int decodeTable(const struct input_event* event, Status_t* status);
+uint filterChain(const struct input_event* events, size_t count);
+uint filterTable(const struct input_event* events, size_t count);
+uint filterScalar(const struct input_event* events, size_t count);
+uint filterSse2(const struct input_event* events, size_t count);
+uint filterAvx2(const struct input_event* events, size_t count);
+uint filterKeys(const struct input_event* events, size_t count);
+uint64_t runSession(uint (*filter)(const struct input_event*, size_t));
+uint64_t benchChain(void);
+uint64_t benchTable(void);
+uint64_t benchScalar(void);
+uint64_t benchSse2(void);
+uint64_t benchAvx2(void);
+uint64_t benchKeys(void);
+uint64_t benchPlayCopy(void);
+uint64_t benchMixS16(void);
+uint64_t benchMixS32(void);
+uint64_t benchMixFloat(void);
+uint64_t benchResample(void);
+uint64_t benchS16ToFloat(void);
+uint64_t benchEncodeMono(void);
+uint64_t benchEncodeStereo(void);
+uint64_t readCycles(void);
+int pinCpu(uint cpu);
+int setupBench(void);
+void runCase(const Bench_Case* c, int json);
+
+int main(int argc, char** argv);
+
+
+/***************************************************************************
+* void makeSession(struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that fills a buffer with a synthetic typing session.
+*       Each key press and release is the MSC_SCAN, EV_KEY and SYN_REPORT a
+*       real keyboard sends; about one press in fifty toggles a lock, which
+*       adds an LED event.
+*
+* Parameters:
+*        events I/O     struct input_event*     The buffer
+*        count  I/P     size_t                  Number of events
+**************************************************************************/
+void makeSession(struct input_event* events, size_t count)
+{
+        srand(SEED);
+        memset(events, 0, count * sizeof(struct input_event));
+
+        size_t i = 0;
+        while(i < count){
+                int key = KEY_A + rand() % 26;
+                int lock = rand() % 50 == 0;
+                for(int value = 1; value >= 0; value--){
+                /*press, then release*/
+                        struct input_event e[4];
+                        int n = 0;
+                        memset(e, 0, sizeof(e));
+                        e[n].type = EV_MSC; e[n].code = MSC_SCAN;
+                        e[n++].value = key;
+                        e[n].type = EV_KEY; e[n].code = key;
+                        e[n++].value = value;
+                        if(lock && value == 1){
+                                e[n].type = EV_LED; e[n].code = LED_CAPSL;
+                                e[n++].value = rand() % 2;
+                        }
+                        e[n].type = EV_SYN; e[n++].code = SYN_REPORT;
+
+                        for(int j = 0; j < n && i < count; j++, i++){
+                                events[i] = e[j];
+                                events[i].input_event_sec = i / 1000;
+                                events[i].input_event_usec = i % 1000 * 1000;
+                        }
+                }
+        }
+}
+
+/***************************************************************************
+* int decodeTable(const struct input_event* event, Status_t* status)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes an input event the same as
+*       decodeLedEvent, but with one range check and a table lookup in place
+*       of the chain of six comparisons
+*
+* Parameters:
+*        event          I/P     const struct input_event*       The event
+*        status         I/O     Status_t*       The decoded status
+*        decodeTable    O/P     int     Bool return of whether the event is a
+*                                       lock LED change
+**************************************************************************/
+int decodeTable(const struct input_event* event, Status_t* status)
+{
+        if(event->type != EV_LED || event->code > LED_SCROLLL
+                || (uint)event->value > 1)
+                return 0;
+        *status = g_ledTable[event->code][event->value];
+        return 1;
+}
+
+/***************************************************************************
+* uint filterChain(const struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes every event with the cmpEventVals chain,
+*       the way the server used to
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t  Number of events
+*        filterChain    O/P     uint    Number of lock changes found
+**************************************************************************/
+uint filterChain(const struct input_event* events, size_t count)
+{
+        uint found = 0;
+        for(size_t i = 0; i < count; i++){
+                Status_t status;
+                found += decodeLedEvent(events[i], &status);
+        }
+        return found;
+}
+
+/***************************************************************************
+* uint filterTable(const struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes every event with the lookup table
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t  Number of events
+*        filterTable    O/P     uint    Number of lock changes found
+**************************************************************************/
+uint filterTable(const struct input_event* events, size_t count)
+{
+        uint found = 0;
+        for(size_t i = 0; i < count; i++){
+                Status_t status;
+                found += decodeTable(&events[i], &status);
+        }
+        return found;
+}
+
+/***************************************************************************
+* uint filterScalar(const struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes only the events the scalar scanner finds
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t  Number of events
+*        filterScalar   O/P     uint    Number of lock changes found
+**************************************************************************/
+uint filterScalar(const struct input_event* events, size_t count)
+{
+        uint32_t idx[BATCH];
+        size_t n = scanEventsScalar(events, count, idx, 0);
+        uint found = 0;
+        for(size_t i = 0; i < n; i++){
+                Status_t status;
+                found += decodeLedEvent(events[idx[i]], &status);
+        }
+        return found;
+}
+
+/***************************************************************************
+* uint filterSse2(const struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes only the events the SSE2 scanner finds
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t  Number of events
+*        filterSse2     O/P     uint    Number of lock changes found
+**************************************************************************/
+uint filterSse2(const struct input_event* events, size_t count)
+{
+#ifdef __SSE2__
+        uint32_t idx[BATCH];
+        size_t n = scanEventsSse2(events, count, idx, 0);
+        uint found = 0;
+        for(size_t i = 0; i < n; i++){
+                Status_t status;
+                found += decodeLedEvent(events[idx[i]], &status);
+        }
+        return found;
+#else
+        (void)events;
+        (void)count;
+        return 0;
+#endif
+}
+
+/***************************************************************************
+* uint filterAvx2(const struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes only the events the AVX2 scanner finds
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t  Number of events
+*        filterAvx2     O/P     uint    Number of lock changes found
+**************************************************************************/
+uint filterAvx2(const struct input_event* events, size_t count)
+{
+#ifdef __AVX2__
+        uint32_t idx[BATCH];
+        size_t n = scanEventsAvx2(events, count, idx, 0);
+        uint found = 0;
+        for(size_t i = 0; i < n; i++){
+                Status_t status;
+                found += decodeLedEvent(events[idx[i]], &status);
+        }
+        return found;
+#else
+        (void)events;
+        (void)count;
+        return 0;
+#endif
+}
+
+/***************************************************************************
+* uint filterKeys(const struct input_event* events, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes the lock changes and key presses the
+*       scanner finds, the way the server does in typewriter mode
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t  Number of events
+*        filterKeys     O/P     uint    Number of lock changes and key
+*                                       presses found
+**************************************************************************/
+uint filterKeys(const struct input_event* events, size_t count)
+{
+        uint32_t idx[BATCH];
+        size_t n = scanEvents(events, count, idx, 1);
+        uint found = 0;
+        for(size_t i = 0; i < n; i++){
+                Status_t status;
+                if(decodeLedEvent(events[idx[i]], &status)
+                        || decodeKeyEvent(events[idx[i]], TYPEWRITER_REPEATS,
+                                                &status))
+                        found++;
+        }
+        return found;
+}
+
+/***************************************************************************
+* uint64_t runSession(uint (*filter)(const struct input_event*, size_t))
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that runs a filter over the whole session in batches
+*       the size the server reads
+*
+* Parameters:
+*        filter         I/P     function        The filter
+*        runSession     O/P     uint64_t        Number of lock changes found
+**************************************************************************/
+uint64_t runSession(uint (*filter)(const struct input_event*, size_t))
+{
+        uint64_t found = 0;
+        for(size_t i = 0; i < SESSION_EVENTS; i += BATCH)
+                found += filter(g_session + i, BATCH);
+        return found;
+}
+
+/***************************************************************************
+* uint64_t benchChain(void)
+* uint64_t benchTable(void)
+* uint64_t benchScalar(void)
+* uint64_t benchSse2(void)
+* uint64_t benchAvx2(void)
+* uint64_t benchKeys(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Functions that run one round of each way of finding the lock
+*       changes in the session
+*
+* Parameters:
+*        bench...       O/P     uint64_t        Number of lock changes found
+**************************************************************************/
+uint64_t benchChain(void)       { return runSession(filterChain); }
+uint64_t benchTable(void)       { return runSession(filterTable); }
+uint64_t benchScalar(void)      { return runSession(filterScalar); }
+uint64_t benchSse2(void)        { return runSession(filterSse2); }
+uint64_t benchAvx2(void)        { return runSession(filterAvx2); }
+uint64_t benchKeys(void)        { return runSession(filterKeys); }
+
+/***************************************************************************
+* uint64_t benchPlayCopy(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that plays the ding through playSound to the null
+*       output, which times its period by period copy loop and nothing else
+*
+* Parameters:
+*        benchPlayCopy  O/P     uint64_t        Frames written
+**************************************************************************/
+uint64_t benchPlayCopy(void)
+{
+        g_device.sinkFrames = 0;
+        for(int i = 0; i < PLAYS; i++)
+                playSound(g_capsOnAsset.data, g_capsOnAsset.size, &g_device, i);
+        return g_device.sinkFrames;
+}
+
+/***************************************************************************
+* uint64_t benchMixS16(void)
+* uint64_t benchMixS32(void)
+* uint64_t benchMixFloat(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Functions that mix one buffer of noise into another in each
+*       sample format, clipping as the mixer does. The buffers are copied
+*       back first so every round mixes the same samples.
+*
+* Parameters:
+*        benchMix...    O/P     uint64_t        Checksum of the mix
+**************************************************************************/
+uint64_t benchMixS16(void)
+{
+        int16_t dst[MIX_SAMPLES];
+        memcpy(dst, g_mixS16[0], sizeof(dst));
+        mixSamples((wavByte_t*)dst, (const wavByte_t*)g_mixS16[1], MIX_SAMPLES,
+                        SND_PCM_FORMAT_S16_LE);
+        return (uint16_t)dst[0] + (uint16_t)dst[MIX_SAMPLES - 1];
+}
+
+uint64_t benchMixS32(void)
+{
+        int32_t dst[MIX_SAMPLES];
+        memcpy(dst, g_mixS32[0], sizeof(dst));
+        mixSamples((wavByte_t*)dst, (const wavByte_t*)g_mixS32[1], MIX_SAMPLES,
+                        SND_PCM_FORMAT_S32_LE);
+        return (uint32_t)dst[0] + (uint32_t)dst[MIX_SAMPLES - 1];
+}
+
+uint64_t benchMixFloat(void)
+{
+        float dst[MIX_SAMPLES];
+        memcpy(dst, g_mixFloat[0], sizeof(dst));
+        mixSamples((wavByte_t*)dst, (const wavByte_t*)g_mixFloat[1], MIX_SAMPLES,
+                        SND_PCM_FORMAT_FLOAT_LE);
+        return (uint64_t)((dst[0] + dst[MIX_SAMPLES - 1] + 2.0f) * 1000);
+}
+
+/***************************************************************************
+* uint64_t benchResample(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that resamples the decoded ding to RESAMPLE_RATE, as
+*       is done for a device that doesn't take its rate
+*
+* Parameters:
+*        benchResample  O/P     uint64_t        Samples produced
+**************************************************************************/
+uint64_t benchResample(void)
+{
+        return resampleLinear(g_capsOnDecoded.samples, g_capsOnDecoded.count,
+                                g_capsOnDecoded.rate, g_resampled,
+                                RESAMPLE_RATE);
+}
+
+/***************************************************************************
+* uint64_t benchS16ToFloat(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that converts the 16 bit samples of the embedded ding
+*       to floating point, as is done when it is decoded
+*
+* Parameters:
+*        benchS16ToFloat        O/P     uint64_t        Checksum of the output
+**************************************************************************/
+uint64_t benchS16ToFloat(void)
+{
+        Wav_Info info;
+        parseWav(Caps_On_wav, Caps_On_wav_size, &info);
+        s16ToFloat(info.samples, g_resampled, info.count, info.channels);
+        return (uint64_t)((g_resampled[info.count / 2] + 1.0f) * 1000);
+}
+
+/***************************************************************************
+* uint64_t benchEncodeMono(void)
+* uint64_t benchEncodeStereo(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Functions that convert the decoded ding to 16 bit samples, for
+*       a mono device and for a stereo one
+*
+* Parameters:
+*        benchEncode... O/P     uint64_t        Checksum of the output
+**************************************************************************/
+uint64_t benchEncodeMono(void)
+{
+        encodeSamples(g_capsOnDecoded.samples, g_capsOnDecoded.count, g_encoded,
+                        SND_PCM_FORMAT_S16_LE, 1);
+        return ((uint16_t*)g_encoded)[g_capsOnDecoded.count / 2];
+}
+
+uint64_t benchEncodeStereo(void)
+{
+        encodeSamples(g_capsOnDecoded.samples, g_capsOnDecoded.count, g_encoded,
+                        SND_PCM_FORMAT_S16_LE, 2);
+        return ((uint16_t*)g_encoded)[g_capsOnDecoded.count];
+}
+
+/***************************************************************************
+* uint64_t readCycles(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads the time stamp counter, which counts at a
+*       fixed rate near the CPU's base clock. Elsewhere there is no counter,
+*       and the bytes per cycle are reported as 0.
+*
+* Parameters:
+*        readCycles     O/P     uint64_t        The counter
+**************************************************************************/
+uint64_t readCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+}
+
+/***************************************************************************
+* int pinCpu(uint cpu)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that pins the benchmark to one CPU, so it isn't
+*       moved between cores or clock domains in the middle of a case
+*
+* Parameters:
+*        cpu    I/P     uint    The CPU
+*        pinCpu O/P     int     Bool-type return value of whether there was a
+*                               failure
+**************************************************************************/
+int pinCpu(uint cpu)
+{
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if(sched_setaffinity(0, sizeof(set), &set) < 0){
+                fprintf(stderr, "Failed to pin to CPU %u: %s\n", cpu,
+                        strerror(errno));
+                return 0;
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int setupBench(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that prepares the inputs of every case: the typing
+*       session, noise to mix, the decoded sounds, and the sounds converted
+*       for the null output, which plays 16 bit mono at the sounds' own rate
+*
+* Parameters:
+*        setupBench     O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int setupBench(void)
+{
+        g_session = (struct input_event*)
+                malloc(SESSION_EVENTS * sizeof(struct input_event));
+        if(g_session == NULL)
+                return 0;
+        makeSession(g_session, SESSION_EVENTS);
+
+        srand(SEED);
+        for(int b = 0; b < 2; b++){
+                for(int i = 0; i < MIX_SAMPLES; i++){
+                        int r = rand() % 65536 - 32768;
+                        g_mixS16[b][i] = r;
+                        g_mixS32[b][i] = r * 65536;
+                        g_mixFloat[b][i] = r / 32768.0f;
+                }
+        }
+
+        memset(&g_device, 0, sizeof(g_device));
+        g_device.sink = &g_nullSink;
+        g_device.periodTime = PERIOD_TIME;
+        g_device.bufferTime = BUFFER_TIME;
+        if(!g_device.sink->open(&g_device) || !prepareAssets(&g_device))
+                return 0;
+
+        long int most = (long int)((int64_t)g_capsOnDecoded.count
+                                * RESAMPLE_RATE / g_capsOnDecoded.rate) + 1;
+        if(most < g_capsOnDecoded.count * 2)
+                most = g_capsOnDecoded.count * 2;
+        g_resampled = (float*)malloc(most * sizeof(float));
+        g_encoded = (wavByte_t*)malloc(most * 2 * sizeof(int16_t));
+        return g_resampled != NULL && g_encoded != NULL;
+}
+
+/***************************************************************************
+* void runCase(const Bench_Case* c, int json)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that runs a case once to warm up the caches and branch
+*       predictors, then times ROUNDS rounds of it and prints the median in ns
+*       per operation and bytes of input per cycle
+*
+* Parameters:
+*        c      I/P     const Bench_Case*       The case
+*        json   I/P     int     Whether to print a JSON line instead of a row
+**************************************************************************/
+void runCase(const Bench_Case* c, int json)
+{
+        int64_t ns[ROUNDS];
+        uint64_t cycles[ROUNDS];
+        volatile uint64_t sum = c->run();
+        /*volatile so the work is not optimised away*/
+
+        for(int round = 0; round < ROUNDS; round++){
+                int64_t start = getMonotonicNs();
+                uint64_t startCycles = readCycles();
+                sum = c->run();
+                cycles[round] = readCycles() - startCycles;
+                ns[round] = getMonotonicNs() - start;
+        }
+
+        for(int i = 1; i < ROUNDS; i++){
+        /*sort both, the medians are all that is reported*/
+                for(int j = i; j > 0 && ns[j] < ns[j-1]; j--){
+                        int64_t t = ns[j]; ns[j] = ns[j-1]; ns[j-1] = t;
+                }
+                for(int j = i; j > 0 && cycles[j] < cycles[j-1]; j--){
+                        uint64_t t = cycles[j]; cycles[j] = cycles[j-1];
+                        cycles[j-1] = t;
+                }
+        }
+
+        double nsPerOp = (double)ns[ROUNDS / 2] / c->ops;
+        double bytesPerCycle = cycles[ROUNDS / 2]
+                                ? (double)c->bytes / cycles[ROUNDS / 2] : 0;
+
+        if(json)
+                printf("{\"case\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.3f,"
+                        "\"bytes_per_cycle\":%.3f,\"checksum\":%llu}\n",
+                        c->name, (unsigned long long)c->ops, nsPerOp,
+                        bytesPerCycle, (unsigned long long)sum);
+        else
+                printf("%-18s %12.3f ns/op %9.3f B/cycle %12llu\n", c->name,
+                        nsPerOp, bytesPerCycle, (unsigned long long)sum);
+}
+
+/***************************************************************************
+* int main(int argc, char** argv)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The main function. -j prints JSON lines, and any other
+*       argument only runs the cases whose names start with it.
+*
+* Parameters:
+*        argc   I/P     int     Number of arguments
+*        argv   I/P     char**  The arguments
+*        main   O/P     int     The return value
+**************************************************************************/
+int main(int argc, char** argv)
+{
+        int json = 0;
+        const char* only = NULL;
+        uint cpu = getConfigUInt("DINGER_CPU", 0);
+
+        for(int i = 1; i < argc; i++){
+                if(strcmp(argv[i], "-j") == 0)
+                        json = 1;
+                else
+                        only = argv[i];
+        }
+
+        pinCpu(cpu);
+        if(!setupBench()){
+                fprintf(stderr, "Failed to prepare the benchmarks\n");
+                return -1;
+        }
+
+        const uint64_t events = SESSION_EVENTS;
+        const uint64_t eventBytes = SESSION_EVENTS * sizeof(struct input_event);
+        const uint64_t samples = g_capsOnDecoded.count;
+        const Bench_Case cases[] = {
+                {"decode_chain", benchChain, events, eventBytes},
+                {"decode_table", benchTable, events, eventBytes},
+                {"scan_scalar", benchScalar, events, eventBytes},
+#ifdef __SSE2__
+                {"scan_sse2", benchSse2, events, eventBytes},
+#endif
+#ifdef __AVX2__
+                {"scan_avx2", benchAvx2, events, eventBytes},
+#endif
+                {"scan_keys", benchKeys, events, eventBytes},
+                {"play_copy", benchPlayCopy, PLAYS,
+                        PLAYS * (uint64_t)g_capsOnAsset.size},
+                {"mix_s16", benchMixS16, MIX_SAMPLES,
+                        MIX_SAMPLES * 2 * sizeof(int16_t)},
+                {"mix_s32", benchMixS32, MIX_SAMPLES,
+                        MIX_SAMPLES * 2 * sizeof(int32_t)},
+                {"mix_float", benchMixFloat, MIX_SAMPLES,
+                        MIX_SAMPLES * 2 * sizeof(float)},
+                {"resample_48k", benchResample, samples,
+                        samples * sizeof(float)},
+                {"s16_to_float", benchS16ToFloat, samples,
+                        samples * sizeof(int16_t)},
+                {"encode_s16_mono", benchEncodeMono, samples,
+                        samples * sizeof(float)},
+                {"encode_s16_stereo", benchEncodeStereo, samples,
+                        samples * sizeof(float)},
+        };
+
+        if(json)
+                printf("{\"seed\":%d,\"cpu\":%u,\"rounds\":%d,\"compiler\":\"%s\"}\n",
+                        SEED, cpu, ROUNDS, __VERSION__);
+        else
+                printf("Seed %d, CPU %u, median of %d rounds\n", SEED, cpu, ROUNDS);
+
+        for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++){
+                if(only != NULL
+                        && strncmp(cases[i].name, only, strlen(only)) != 0)
+                        continue;
+                runCase(&cases[i], json);
+        }
+
+        free(g_session);
+        free(g_resampled);
+        free(g_encoded);
+        return 0;
+}
@@ -0,0 +1,553 @@
+/***************************************************************************
+* File:  Assets.h
+* Author:  SkibbleBip
+* Procedures:
+* parseWav              -Function that locates the format and sample data of
+*                               an embedded WAV file
+* s16ToFloat            -Function that converts signed 16 bit samples into
+*                               floating point samples
+* resampleLinear        -Function that resamples floating point samples to a
+*                               different rate
+* encodeSamples         -Function that converts floating point mono samples
+*                               into the device's format and channel count
+* decodeAsset           -Function that decodes an embedded WAV file into
+*                               floating point mono samples
+* synthClick            -Function that synthesises the click of a class of
+*                               key for typewriter mode
+* decodeAssets          -Function that decodes all of the embedded sounds and
+*                               synthesises the clicks
+* convertAsset          -Function that converts a decoded sound into the
+*                               device's native format
+* prepareAssets         -Function that converts all of the sounds into the
+*                               device's native format
+* freeAssets            -Function that frees the converted sounds
+***************************************************************************/
+
+#ifndef ASSETS_H_INCLUDED
+#define ASSETS_H_INCLUDED
+
+#include <stdint.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../main.h"
+#include "Sound.h"
+#include "CapsOn.h"
+#include "CapsOff.h"
+
+#define         CLICK_RATE      48000
+/*Rate the clicks are synthesised at, before they are converted*/
+
+
+/*Struct to contain a sound that was converted into the device's format*/
+typedef struct {
+        wavByte_t* data;
+        long int size;
+} Sound_Asset;
+
+/*Struct to contain a sound decoded into mono floating point samples*/
+typedef struct {
+        float* samples;
+        long int count;
+        uint rate;
+} Decoded_Asset;
+
+/*Struct to contain the shape of a click*/
+typedef struct {
+        float pitch;
+        /*frequency of the tone under the noise, in Hz*/
+        float length;
+        /*in milliseconds*/
+        float level;
+        /*peak amplitude, from 0 to 1*/
+} Click_Shape;
+
+/*Struct to contain the properties of a parsed WAV file*/
+typedef struct {
+        const int16_t* samples;
+        long int count;
+        uint rate;
+        uint channels;
+} Wav_Info;
+
+
+Decoded_Asset g_capsOnDecoded;
+Decoded_Asset g_capsOffDecoded;
+/*The sounds decoded from the embedded WAV files*/
+Decoded_Asset g_clickDecoded[CLICK_CLASSES];
+/*The synthesised clicks, from CLICK_KEY on*/
+Sound_Asset g_capsOnAsset;
+Sound_Asset g_capsOffAsset;
+Sound_Asset g_clickAsset[CLICK_CLASSES];
+/*The sounds in the format of the opened PCM device*/
+
+const Click_Shape g_clickShapes[CLICK_CLASSES] = {
+        {2200.0f, 18.0f, 0.30f},
+        /*a letter key, short and bright*/
+        {900.0f, 35.0f, 0.35f},
+        /*the space bar, lower and longer*/
+        {600.0f, 60.0f, 0.40f},
+        /*enter, the heaviest*/
+        {1500.0f, 25.0f, 0.30f}
+        /*backspace and delete*/
+};
+
+
+/***************************************************************************
+* int parseWav(const unsigned char* wav, long int size, Wav_Info* info)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that walks the RIFF chunks of an embedded WAV file and
+*       locates its format and sample data. Only 16 bit PCM is accepted, as
+*       that is what the bundled sounds are.
+*
+* Parameters:
+*        wav            I/P     const unsigned char*    The WAV file data
+*        size           I/P     long int                Size of the WAV data
+*        info           I/O     Wav_Info*               The parsed properties
+*        parseWav       O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int parseWav(const unsigned char* wav, long int size, Wav_Info* info)
+{
+        if(size < 12 || memcmp(wav, "RIFF", 4) != 0
+                || memcmp(wav+8, "WAVE", 4) != 0)
+                return 0;
+
+        long int c = 12;
+        /*skip the RIFF header*/
+        int haveFormat = 0;
+
+        while(c + 8 <= size){
+                uint32_t chunkSize = wav[c+4] | (wav[c+5] << 8)
+                        | (wav[c+6] << 16) | ((uint32_t)wav[c+7] << 24);
+                const unsigned char* chunk = wav + c + 8;
+
+                if(0 == memcmp(wav+c, "fmt ", 4) && chunkSize >= 16){
+                        uint format = chunk[0] | (chunk[1] << 8);
+                        uint bits = chunk[14] | (chunk[15] << 8);
+                        if(format != 1 || bits != 16)
+                        /*not 16 bit PCM*/
+                                return 0;
+                        info->channels = chunk[2] | (chunk[3] << 8);
+                        info->rate = chunk[4] | (chunk[5] << 8)
+                                | (chunk[6] << 16) | ((uint)chunk[7] << 24);
+                        haveFormat = 1;
+                }
+                else if(0 == memcmp(wav+c, "data", 4) && haveFormat){
+                        if(chunkSize > size - c - 8)
+                        /*clip a truncated data chunk*/
+                                chunkSize = size - c - 8;
+                        info->samples = (const int16_t*)chunk;
+                        info->count = chunkSize / 2;
+                        return info->channels > 0;
+                }
+
+                c += 8 + chunkSize + (chunkSize & 1);
+                /*chunks are padded to an even length*/
+        }
+
+        return 0;
+}
+
+/***************************************************************************
+* void s16ToFloat(const int16_t* in, float* out, long int count, uint stride)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that converts signed 16 bit samples into floating
+*       point samples between -1 and 1. A stride larger than 1 takes only the
+*       first channel of interleaved data.
+*
+* Parameters:
+*        in     I/P     const int16_t*  The input samples
+*        out    I/O     float*          The output samples
+*        count  I/P     long int        Number of output samples
+*        stride I/P     uint            Distance between input samples
+**************************************************************************/
+void s16ToFloat(const int16_t* in, float* out, long int count, uint stride)
+{
+        long int i = 0;
+        const float scale = 1.0f / 32768.0f;
+#ifdef __SSE2__
+        if(stride == 1){
+                const __m128 vScale = _mm_set1_ps(scale);
+                for(; i + 8 <= count; i += 8){
+                /*sign extend 8 samples to 32 bits and convert them at once*/
+                        __m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+                        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+                        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+                        _mm_storeu_ps(out + i,
+                                _mm_mul_ps(_mm_cvtepi32_ps(lo), vScale));
+                        _mm_storeu_ps(out + i + 4,
+                                _mm_mul_ps(_mm_cvtepi32_ps(hi), vScale));
+                }
+        }
+#endif
+        for(; i < count; i++){
+                int16_t s;
+                memcpy(&s, in + i*stride, sizeof(s));
+                /*the embedded data is not guaranteed to be aligned*/
+                out[i] = s * scale;
+        }
+}
+
+/***************************************************************************
+* long int resampleLinear(const float* in, long int inCount, uint inRate,
+*                               float* out, uint outRate)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that resamples floating point samples from one rate
+*       to another using linear interpolation. Positions are kept in fixed
+*       point, so with SSE2 four of them are worked out at once, and both
+*       paths give the same samples. The output buffer must hold
+*       inCount * outRate / inRate + 1 samples.
+*
+* Parameters:
+*        in             I/P     const float*    The input samples
+*        inCount        I/P     long int        Number of input samples
+*        inRate         I/P     uint            Rate of the input samples
+*        out            I/O     float*          The output samples
+*        outRate        I/P     uint            Rate of the output samples
+*        resampleLinear O/P     long int        Number of output samples
+**************************************************************************/
+long int resampleLinear(const float* in, long int inCount, uint inRate,
+                                float* out, uint outRate)
+{
+        if(inCount < 2 || inRate == outRate){
+                memcpy(out, in, inCount * sizeof(float));
+                return inCount;
+        }
+
+        long int outCount = (long int)((int64_t)(inCount - 1) * outRate / inRate) + 1;
+        const uint64_t step = ((uint64_t)inRate << 32) / outRate;
+        /*distance between output samples in the input, in 32.32 fixed
+        * point. The fraction is used to 24 bits, which a float holds*/
+        const float fracScale = 1.0f / (1 << 24);
+        long int i = 0;
+#ifdef __SSE2__
+        long int safe = (long int)((((uint64_t)(inCount - 1) << 32) - 1) / step) + 1;
+        /*every output before this one lies before the last input sample, so
+        * needs no clamping*/
+        if(safe > outCount)
+                safe = outCount;
+
+        const __m128i vStep = _mm_set1_epi64x((long long)(step * 4));
+        const __m128i vLow = _mm_set1_epi64x(0xffffffffLL);
+        const __m128 vScale = _mm_set1_ps(fracScale);
+        __m128i pos01 = _mm_set_epi64x((long long)step, 0);
+        __m128i pos23 = _mm_set_epi64x((long long)(step * 3),
+                                        (long long)(step * 2));
+        int32_t idx[4] __attribute__((aligned(16)));
+
+        for(; i + 4 <= safe; i += 4){
+        /*the positions of 4 output samples are stepped along two to a
+        * register, then their indices and fractions are packed into one
+        * register each. SSE2 has no gather, so only the loads are scalar*/
+                __m128i vIdx = _mm_unpacklo_epi64(
+                        _mm_shuffle_epi32(_mm_srli_epi64(pos01, 32),
+                                        _MM_SHUFFLE(3, 3, 2, 0)),
+                        _mm_shuffle_epi32(_mm_srli_epi64(pos23, 32),
+                                        _MM_SHUFFLE(3, 3, 2, 0)));
+                __m128i vFrac = _mm_unpacklo_epi64(
+                        _mm_shuffle_epi32(_mm_srli_epi64(
+                                _mm_and_si128(pos01, vLow), 8),
+                                        _MM_SHUFFLE(3, 3, 2, 0)),
+                        _mm_shuffle_epi32(_mm_srli_epi64(
+                                _mm_and_si128(pos23, vLow), 8),
+                                        _MM_SHUFFLE(3, 3, 2, 0)));
+                _mm_store_si128((__m128i*)idx, vIdx);
+
+                __m128 va = _mm_set_ps(in[idx[3]], in[idx[2]],
+                                        in[idx[1]], in[idx[0]]);
+                __m128 vb = _mm_set_ps(in[idx[3] + 1], in[idx[2] + 1],
+                                        in[idx[1] + 1], in[idx[0] + 1]);
+                __m128 vf = _mm_mul_ps(_mm_cvtepi32_ps(vFrac), vScale);
+                _mm_storeu_ps(out + i,
+                        _mm_add_ps(va, _mm_mul_ps(vf, _mm_sub_ps(vb, va))));
+
+                pos01 = _mm_add_epi64(pos01, vStep);
+                pos23 = _mm_add_epi64(pos23, vStep);
+        }
+#endif
+        for(; i < outCount; i++){
+                uint64_t pos = (uint64_t)i * step;
+                long int idx = (long int)(pos >> 32);
+                float frac = (float)((pos & 0xffffffffu) >> 8) * fracScale;
+                if(idx >= inCount - 1){
+                        idx = inCount - 2;
+                        frac = 1.0f;
+                }
+                out[i] = in[idx] + frac * (in[idx+1] - in[idx]);
+        }
+
+        return outCount;
+}
+
+/***************************************************************************
+* void encodeSamples(const float* in, long int count, wavByte_t* out,
+*                       snd_pcm_format_t format, uint channels)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that converts floating point mono samples into the
+*       device's sample format, copying each sample into every channel
+*
+* Parameters:
+*        in             I/P     const float*            The input samples
+*        count          I/P     long int                Number of samples
+*        out            I/O     wavByte_t*              The output frames
+*        format         I/P     snd_pcm_format_t        The output format
+*        channels       I/P     uint                    The output channels
+**************************************************************************/
+void encodeSamples(const float* in, long int count, wavByte_t* out,
+                        snd_pcm_format_t format, uint channels)
+{
+        long int i = 0;
+
+        switch(format){
+        case SND_PCM_FORMAT_S16_LE:{
+                int16_t* dst = (int16_t*)out;
+#ifdef __SSE2__
+                if(channels == 1){
+                        const __m128 vScale = _mm_set1_ps(32767.0f);
+                        for(; i + 8 <= count; i += 8){
+                        /*convert and saturate 8 samples at once*/
+                                __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(
+                                        _mm_loadu_ps(in + i), vScale));
+                                __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(
+                                        _mm_loadu_ps(in + i + 4), vScale));
+                                _mm_storeu_si128((__m128i*)(dst + i),
+                                        _mm_packs_epi32(lo, hi));
+                        }
+                }
+#endif
+                for(; i < count; i++){
+                        float v = in[i] * 32767.0f;
+                        int16_t s = v > 32767.0f ? 32767
+                                : v < -32768.0f ? -32768 : (int16_t)lrintf(v);
+                        for(uint ch = 0; ch < channels; ch++)
+                                dst[i*channels + ch] = s;
+                }
+                break;
+        }
+        case SND_PCM_FORMAT_S32_LE:{
+                int32_t* dst = (int32_t*)out;
+                for(; i < count; i++){
+                        double v = in[i] * 2147483647.0;
+                        int32_t s = v > 2147483647.0 ? INT32_MAX
+                                : v < -2147483648.0 ? INT32_MIN : (int32_t)lrint(v);
+                        for(uint ch = 0; ch < channels; ch++)
+                                dst[i*channels + ch] = s;
+                }
+                break;
+        }
+        case SND_PCM_FORMAT_FLOAT_LE:{
+                float* dst = (float*)out;
+                for(; i < count; i++)
+                        for(uint ch = 0; ch < channels; ch++)
+                                dst[i*channels + ch] = in[i];
+                break;
+        }
+        default:
+                memset(out, 0, count * channels
+                        * (snd_pcm_format_physical_width(format) / 8));
+                break;
+        }
+}
+
+/***************************************************************************
+* int decodeAsset(const unsigned char* wav, long int size, Decoded_Asset* out)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes an embedded WAV file into floating point
+*       mono samples at its own rate. This part doesn't depend on the device,
+*       so it can be done before the device is opened.
+*
+* Parameters:
+*        wav            I/P     const unsigned char*    The WAV file data
+*        size           I/P     long int                Size of the WAV data
+*        out            I/O     Decoded_Asset*          The decoded sound
+*        decodeAsset    O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int decodeAsset(const unsigned char* wav, long int size, Decoded_Asset* out)
+{
+        Wav_Info info;
+        if(!parseWav(wav, size, &info)){
+                LOGMSG(LOG_ERR, "Failed to parse embedded sound\n");
+                return 0;
+        }
+
+        out->count = info.count / info.channels;
+        /*only the first channel of the sound is used*/
+        out->rate = info.rate;
+        out->samples = (float*) malloc((out->count ? out->count : 1)
+                                        * sizeof(float));
+        if(out->samples == NULL)
+                return 0;
+
+        s16ToFloat(info.samples, out->samples, out->count, info.channels);
+        return 1;
+}
+
+/***************************************************************************
+* int synthClick(const Click_Shape* shape, uint seed, Decoded_Asset* out)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that synthesises a key click: a burst of noise and a
+*       tone, both dying away quickly, with a short fade in so it starts
+*       without a pop. The noise comes from a fixed seed, so a click sounds
+*       the same every time.
+*
+* Parameters:
+*        shape          I/P     const Click_Shape*      The click
+*        seed           I/P     uint                    Seed of the noise
+*        out            I/O     Decoded_Asset*          The synthesised sound
+*        synthClick     O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int synthClick(const Click_Shape* shape, uint seed, Decoded_Asset* out)
+{
+        const float fade = CLICK_RATE / 2000.0f;
+        /*half a millisecond*/
+        const float decay = shape->length / 1000.0f * CLICK_RATE / 5.0f;
+        /*down to 1% by the end*/
+        uint32_t noise = seed * 2654435761u + 1;
+
+        out->rate = CLICK_RATE;
+        out->count = (long int)(shape->length * CLICK_RATE / 1000.0f);
+        out->samples = (float*) malloc(out->count * sizeof(float));
+        if(out->samples == NULL)
+                return 0;
+
+        for(long int i = 0; i < out->count; i++){
+                noise = noise * 1664525u + 1013904223u;
+                float n = (int32_t)noise / 2147483648.0f;
+                float t = sinf(2.0f * (float)M_PI * shape->pitch * i / CLICK_RATE);
+                float env = expf(-i / decay) * (i < fade ? i / fade : 1.0f);
+                out->samples[i] = shape->level * env * (0.6f * n + 0.4f * t);
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int decodeAssets(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes all of the embedded sounds and
+*       synthesises the clicks, if that has not been done already
+*
+* Parameters:
+*        decodeAssets   O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int decodeAssets(void)
+{
+        if(g_capsOnDecoded.samples == NULL
+                && !decodeAsset(Caps_On_wav, Caps_On_wav_size, &g_capsOnDecoded))
+                return 0;
+        if(g_capsOffDecoded.samples == NULL
+                && !decodeAsset(Caps_Off_wav, Caps_Off_wav_size, &g_capsOffDecoded))
+                return 0;
+        for(int i = 0; i < CLICK_CLASSES; i++){
+                if(g_clickDecoded[i].samples == NULL
+                        && !synthClick(&g_clickShapes[i], i, &g_clickDecoded[i]))
+                        return 0;
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int convertAsset(const Decoded_Asset* in, Sound_Device *dev,
+*                       Sound_Asset* asset)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that converts a decoded sound into the rate, channels
+*       and format negotiated by the PCM device, so playing it needs no
+*       conversion at all
+*
+* Parameters:
+*        in             I/P     const Decoded_Asset*    The decoded sound
+*        dev            I/P     Sound_Device*           The opened PCM device
+*        asset          I/O     Sound_Asset*            The converted sound
+*        convertAsset   O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int convertAsset(const Decoded_Asset* in, Sound_Device *dev,
+                        Sound_Asset* asset)
+{
+        long int outMax = (long int)((int64_t)in->count * dev->rate / in->rate) + 1;
+
+        float* resampled = (float*) malloc((outMax > in->count ? outMax : in->count)
+                                                * sizeof(float));
+        if(resampled == NULL)
+                return 0;
+
+        long int outCount = resampleLinear(in->samples, in->count, in->rate,
+                                                resampled, dev->rate);
+
+        asset->size = outCount * dev->frameBytes;
+        asset->data = (wavByte_t*) malloc(asset->size);
+        if(asset->data != NULL){
+                encodeSamples(resampled, outCount, asset->data,
+                                dev->format, dev->channels);
+        }
+
+        free(resampled);
+
+        return asset->data != NULL;
+}
+
+/***************************************************************************
+* int prepareAssets(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that converts all of the sounds into the format of the
+*       opened PCM device, decoding them first if that hasn't been done yet
+*
+* Parameters:
+*        dev            I/P     Sound_Device*   The opened PCM device
+*        prepareAssets  O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int prepareAssets(Sound_Device *dev)
+{
+        if(!decodeAssets())
+                return 0;
+        if(!convertAsset(&g_capsOnDecoded, dev, &g_capsOnAsset))
+                return 0;
+        if(!convertAsset(&g_capsOffDecoded, dev, &g_capsOffAsset))
+                return 0;
+        for(int i = 0; i < CLICK_CLASSES; i++){
+                if(!convertAsset(&g_clickDecoded[i], dev, &g_clickAsset[i]))
+                        return 0;
+        }
+
+        LOGMSG(LOG_NOTICE, "Converted sounds to %u Hz, %u channels, %s\n",
+                dev->rate, dev->channels, snd_pcm_format_name(dev->format));
+        return 1;
+}
+
+/***************************************************************************
+* void freeAssets(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that frees the converted sounds
+*
+* Parameters: N/A
+**************************************************************************/
+void freeAssets(void)
+{
+        free(g_capsOnAsset.data);
+        free(g_capsOffAsset.data);
+        g_capsOnAsset.data = NULL;
+        g_capsOffAsset.data = NULL;
+        for(int i = 0; i < CLICK_CLASSES; i++){
+                free(g_clickAsset[i].data);
+                g_clickAsset[i].data = NULL;
+        }
+}
+
+
+#endif // ASSETS_H_INCLUDED
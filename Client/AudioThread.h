@@ -0,0 +1,330 @@
+/***************************************************************************
+* File:  AudioThread.h
+* Author:  SkibbleBip
+* Procedures:
+* startAudioThread      -Function that starts the thread that owns the PCM
+*                               device
+* stopAudioThread       -Function that has the audio thread close the PCM
+*                               device and waits for it to end
+* audioThreadMain       -The audio thread, which drains the command queue and
+*                               mixes the playing sounds one period at a time
+* writePeriod           -Function that writes a mixed period to the PCM device
+***************************************************************************/
+
+#ifndef AUDIOTHREAD_H_INCLUDED
+#define AUDIOTHREAD_H_INCLUDED
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+#include "../main.h"
+#include "../Probes.h"
+#include "../Journal.h"
+#include "Sound.h"
+#include "Playback.h"
+#include "Queue.h"
+#include "Mixer.h"
+#include "Startup.h"
+
+#define         CLICK_HOLD      300
+/*Milliseconds the device is kept running with silence after a click, so the
+* next key press of a run of typing doesn't wait for a drain and restart*/
+#define         STOP_WAIT       2
+/*Seconds to wait for the audio thread to close the device when shutting
+* down, it may be stuck waiting for a lost device to return*/
+#define         AUDIO_STACK     (512 * 1024)
+/*Stack size of the audio thread, kept small so it fits in RLIMIT_MEMLOCK
+* when memory is locked*/
+
+
+/*Struct to contain the state of the audio thread*/
+typedef struct {
+        Sound_Device *dev;
+        Command_Queue queue;
+        /*play commands from the IPC thread*/
+        Mixer mixer;
+        pthread_t thread;
+        void (*openDevice)(Sound_Device *dev);
+        /*opens the PCM device and converts the sounds for it*/
+        int lazy;
+        /*whether the device is only opened for the first command*/
+        uint priority;
+        /*SCHED_FIFO priority of the thread, 0 to leave it alone*/
+        long int holdFrames;
+        /*frames of silence left to write before draining*/
+        atomic_int stop;
+        /*set to have the thread close the device and end*/
+        int running;
+        /*whether the thread was started*/
+} Audio_Thread;
+
+Audio_Thread g_audio;
+
+void* audioThreadMain(void* arg);
+void stopAudioThread(Audio_Thread* a);
+
+
+/***************************************************************************
+* int startAudioThread(Audio_Thread* a, Sound_Device *dev,
+*                       void (*openDevice)(Sound_Device*), int lazy)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Small stack, for locked memory
+* Description: Function that starts the thread that owns the PCM device. From
+*       then on only the audio thread touches the device; other threads hand
+*       it play commands through the queue.
+*
+* Parameters:
+*        a              I/O     Audio_Thread*   The audio thread state
+*        dev            I/O     Sound_Device*   The PCM device to own
+*        openDevice     I/P     function        Opens the device
+*        lazy           I/P     int             Whether to wait for the first
+*                                               command before opening
+*        startAudioThread       O/P     int     Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int startAudioThread(Audio_Thread* a, Sound_Device *dev,
+                        void (*openDevice)(Sound_Device*), int lazy)
+{
+        sigset_t block;
+        sigset_t old;
+        pthread_attr_t attr;
+
+        a->dev = dev;
+        a->openDevice = openDevice;
+        a->lazy = lazy;
+        a->priority = getConfigUInt("DINGER_AUDIO_PRIO", 0);
+        memset(&a->mixer, 0, sizeof(a->mixer));
+        atomic_init(&a->stop, 0);
+
+        if(!queueInit(&a->queue))
+                return 0;
+
+        sigemptyset(&block);
+        sigaddset(&block, SIGQUIT);
+        sigaddset(&block, SIGTERM);
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, AUDIO_STACK);
+        pthread_sigmask(SIG_BLOCK, &block, &old);
+        /*the thread starts with the shutdown signals blocked, so they are
+        * handled on a thread that can wait for it*/
+        a->running = pthread_create(&a->thread, &attr, audioThreadMain, a) == 0;
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        pthread_attr_destroy(&attr);
+
+        return a->running;
+}
+
+/***************************************************************************
+* void stopAudioThread(Audio_Thread* a)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that has the audio thread play out what is in the
+*       device, close it and end, and waits up to STOP_WAIT for it. Only the
+*       audio thread ever touches the device, so this is how every other
+*       thread closes it. Called on the audio thread itself (ie failing while
+*       opening the device), it closes the device directly.
+*
+* Parameters:
+*        a      I/O     Audio_Thread*   The audio thread state
+**************************************************************************/
+void stopAudioThread(Audio_Thread* a)
+{
+        struct timespec deadline;
+
+        if(!a->running)
+                return;
+        if(pthread_equal(pthread_self(), a->thread)){
+                if(a->dev->sink != NULL)
+                        a->dev->sink->close(a->dev);
+                return;
+        }
+
+        atomic_store_explicit(&a->stop, 1, memory_order_release);
+        sem_post(&a->queue.doorbell);
+        /*wake it if it is sleeping*/
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += STOP_WAIT;
+        int err = pthread_timedjoin_np(a->thread, NULL, &deadline);
+        if(err != 0)
+                LOGMSG(LOG_ALERT, "Audio thread did not stop: %s\n",
+                        strerror(err));
+        a->running = 0;
+}
+
+/***************************************************************************
+* int writePeriod(Audio_Thread* a, wavByte_t* buffer, long int frames)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes a mixed period to the output, which
+*       recovers the device if the write fails
+*
+* Parameters:
+*        a              I/O     Audio_Thread*   The audio thread state
+*        buffer         I/P     wavByte_t*      The mixed frames
+*        frames         I/P     long int        Number of frames to write
+*        writePeriod    O/P     int             Bool-type return value of
+*                                               whether the voices can carry
+*                                               on playing
+**************************************************************************/
+int writePeriod(Audio_Thread* a, wavByte_t* buffer, long int frames)
+{
+        Sound_Device *dev = a->dev;
+
+        PROBE3(pcm_write_start, a->mixer.lastSeq, frames, getBoottimeNs());
+        if(!dev->sink->write(dev, buffer, frames))
+        /*the device had to be reopened and the sounds were converted again,
+        * so the voices can't carry on*/
+                return 0;
+        PROBE3(pcm_write_end, a->mixer.lastSeq, frames, getBoottimeNs());
+
+        return 1;
+}
+
+/***************************************************************************
+* void* audioThreadMain(void* arg)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The audio thread. It sleeps while nothing is playing. Once per
+*       period it takes every waiting command off the queue, starts a voice
+*       for each, and writes the mix of all playing voices to the device. When
+*       the last voice finishes, the device is drained and prepared again,
+*       except after a click, when it is kept running with silence for
+*       CLICK_HOLD in case the typing goes on. Commands are only ever taken a
+*       period at a time and the voices are bounded, so fast typing can't
+*       build up a backlog. When told to stop, it plays out what is in the
+*       device and closes it.
+*
+* Parameters:
+*        arg                    I/O     void*   The Audio_Thread state
+*        audioThreadMain        O/P     void*   Unused
+**************************************************************************/
+void* audioThreadMain(void* arg)
+{
+        Audio_Thread* a = (Audio_Thread*)arg;
+        Sound_Device *dev = a->dev;
+        wavByte_t* buffer = NULL;
+        uint capacity = 0;
+        int ready = 0;
+        int dinged = 0;
+
+        if(a->priority > 0){
+        /*run the thread at real-time priority if asked to*/
+                struct sched_param param;
+                param.sched_priority = a->priority;
+                int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+                if(err != 0)
+                        LOGMSG(LOG_ALERT, "Audio thread SCHED_FIFO %u failed: %s\n",
+                                a->priority, strerror(err));
+                else
+                        LOGMSG(LOG_NOTICE, "Audio thread running at SCHED_FIFO %u\n",
+                                a->priority);
+        }
+
+        if(!a->lazy){
+                a->openDevice(dev);
+                ready = 1;
+        }
+
+        while(1){
+                Play_Command cmd;
+
+                if(a->mixer.count == 0 && a->holdFrames <= 0)
+                /*sleep until there is something to play*/
+                        queueWait(&a->queue);
+                if(atomic_load_explicit(&a->stop, memory_order_acquire))
+                        break;
+
+                while(queuePop(&a->queue, &cmd)){
+                /*start a voice for every command waiting*/
+                        if(!ready){
+                                a->openDevice(dev);
+                                ready = 1;
+                        }
+                        if(cmd.status >= CLICK_KEY){
+                        /*a key press in typewriter mode*/
+                                mixerStart(&a->mixer,
+                                        &g_clickAsset[cmd.status - CLICK_KEY],
+                                        cmd.seq);
+                                a->holdFrames = (long int)dev->rate
+                                                * CLICK_HOLD / 1000;
+                                PROBE3(play_start, cmd.seq, cmd.queuedNs,
+                                        getBoottimeNs());
+                                continue;
+                        }
+
+                        mixerStart(&a->mixer, cmd.status < TOGGLE_AXIS
+                                        ? &g_capsOnAsset : &g_capsOffAsset,
+                                        cmd.seq);
+                        PROBE3(play_start, cmd.seq, cmd.queuedNs,
+                                getBoottimeNs());
+
+                        Journal_Entry* e = journalAt(&g_journal, cmd.journalPos);
+                        if(e != NULL && e->seq == cmd.seq){
+                        /*unless the IPC thread has overwritten it since*/
+                                e->playNs = getBoottimeNs();
+                                e->outcome = OUTCOME_PLAYED;
+                        }
+                        if(a->queue.popped % QUEUE_REPORT == 0)
+                                queueReport(&a->queue);
+                }
+
+                if(a->mixer.count == 0 && a->holdFrames <= 0)
+                        continue;
+
+                if(capacity < dev->buff_size){
+                /*the period may have grown if the device was reopened*/
+                        free(buffer);
+                        capacity = dev->buff_size;
+                        buffer = (wavByte_t*) malloc(capacity);
+                        if(buffer == NULL){
+                                LOGMSG(LOG_ERR, "Failed to allocate period: %m");
+                                capacity = 0;
+                                a->mixer.count = 0;
+                                continue;
+                        }
+                }
+
+                long int frames = mixerRender(&a->mixer, buffer, dev->frames, dev);
+                if(frames == 0){
+                /*holding the device open after a click*/
+                        frames = dev->frames;
+                        memset(buffer, 0, frames * dev->frameBytes);
+                        a->holdFrames -= frames;
+                }
+                if(!writePeriod(a, buffer, frames)){
+                /*the device was reopened and the voices point at the old
+                * sounds, so drop them*/
+                        a->mixer.count = 0;
+                        a->holdFrames = 0;
+                        continue;
+                }
+
+                if(a->mixer.count == 0 && a->holdFrames <= 0){
+                /*the last voice finished, play out what is left*/
+                        dev->sink->drain(dev);
+                        PROBE2(drain_done, a->mixer.lastSeq, getBoottimeNs());
+
+                        if(!dinged){
+                        /*the first ding ends the startup timeline*/
+                                dinged = 1;
+                                markPhase("first ding");
+                                dumpTimeline("first ding");
+                        }
+                }
+        }
+
+        if(ready){
+                if(a->mixer.count > 0 || a->holdFrames > 0)
+                        dev->sink->drain(dev);
+                dev->sink->close(dev);
+        }
+        free(buffer);
+        return NULL;
+}
+
+
+#endif // AUDIOTHREAD_H_INCLUDED
@@ -0,0 +1,361 @@
+/***************************************************************************
+* File:  Calibrate.h
+* Author:  SkibbleBip
+* Procedures:
+* getLatencyStorePath   -Function that generates the location of the file the
+*                               calibrated latencies are stored in
+* loadLatency           -Function that looks up the stored latency of a PCM
+*                               device
+* storeLatency          -Function that saves the latency of a PCM device
+* probeLatency          -Function that plays bursts of silence through a
+*                               single period and buffer configuration and
+*                               measures it
+* calibrateLatency      -Function that finds the smallest stable period and
+*                               buffer configuration of the PCM device
+***************************************************************************/
+
+#ifndef CALIBRATE_H_INCLUDED
+#define CALIBRATE_H_INCLUDED
+
+#include <pwd.h>
+#include <sys/stat.h>
+
+#include "../main.h"
+#include "Sound.h"
+
+#define         CALIBRATE_TIME          500000
+/*How long each configuration is played for in microseconds*/
+#define         CALIBRATE_PERIODS       4
+/*How many periods fit in the buffer of each probed configuration*/
+#define         CALIBRATE_BURST         60000
+/*How long each burst is played for in microseconds, about as long as a ding*/
+#define         CALIBRATE_GAP           20000
+/*How long the device sits idle between bursts in microseconds*/
+#define         CALIBRATE_MARGIN        2
+/*A configuration is rejected if the device gets within 1/CALIBRATE_MARGIN
+* of a period of running dry*/
+
+const uint g_calibratePeriods[] = {20000, 10000, 5000, 2500, 1250};
+/*The period times that are probed in microseconds, largest first*/
+
+
+/***************************************************************************
+* int getLatencyStorePath(char* path, size_t len)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that generates the location of the file the calibrated
+*       latencies are stored in, ie ~/.config/KeyboardDinger/latency, creating
+*       the directory if needed
+*
+* Parameters:
+*        path   I/O     char*   Buffer to write the location into
+*        len    I/P     size_t  Size of the buffer
+*        getLatencyStorePath    O/P     int     Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int getLatencyStorePath(char* path, size_t len)
+{
+        const char* config = getenv("XDG_CONFIG_HOME");
+        if(config != NULL && *config != '\000'){
+                snprintf(path, len, "%s/KeyboardDinger", config);
+        }
+        else{
+        /*if the config directory is not defined, use the default one in the
+        * user's home directory*/
+                struct passwd *pwd = getpwuid(getuid());
+                if(pwd == NULL)
+                        return 0;
+                snprintf(path, len, "%s/.config/KeyboardDinger", pwd->pw_dir);
+        }
+
+        if(mkdir(path, 0755) < 0 && errno != EEXIST){
+                LOGMSG(LOG_ERR, "Failed to create %s: %m", path);
+                return 0;
+        }
+
+        strncat(path, "/latency", len - strlen(path) - 1);
+        return 1;
+}
+
+/***************************************************************************
+* int loadLatency(const char* device, uint* periodTime, uint* bufferTime)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that looks up the stored latency of a PCM device
+*
+* Parameters:
+*        device         I/P     const char*     Name of the PCM device
+*        periodTime     I/O     uint*           Stored period time
+*        bufferTime     I/O     uint*           Stored buffer time
+*        loadLatency    O/P     int             Bool-type return value of
+*                                               whether the device was found
+**************************************************************************/
+int loadLatency(const char* device, uint* periodTime, uint* bufferTime)
+{
+        char path[256];
+        char name[128];
+        uint period, buffer;
+        int found = 0;
+
+        if(!getLatencyStorePath(path, sizeof(path)))
+                return 0;
+
+        FILE* store = fopen(path, "r");
+        if(store == NULL)
+        /*nothing has been calibrated yet*/
+                return 0;
+
+        while(fscanf(store, "%127s %u %u", name, &period, &buffer) == 3){
+        /*each line holds the device name and its period and buffer times*/
+                if(0 == strcmp(name, device)){
+                        *periodTime = period;
+                        *bufferTime = buffer;
+                        found = 1;
+                }
+        }
+
+        fclose(store);
+        return found;
+}
+
+/***************************************************************************
+* int storeLatency(const char* device, uint periodTime, uint bufferTime)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that saves the latency of a PCM device, replacing any
+*       previously stored result for the same device
+*
+* Parameters:
+*        device         I/P     const char*     Name of the PCM device
+*        periodTime     I/P     uint            Period time to store
+*        bufferTime     I/P     uint            Buffer time to store
+*        storeLatency   O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int storeLatency(const char* device, uint periodTime, uint bufferTime)
+{
+        char path[256];
+        char tmpPath[300];
+        char name[128];
+        uint period, buffer;
+
+        if(!getLatencyStorePath(path, sizeof(path)))
+                return 0;
+        snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+        FILE* out = fopen(tmpPath, "w");
+        if(out == NULL){
+                LOGMSG(LOG_ERR, "Failed to open %s: %m", tmpPath);
+                return 0;
+        }
+
+        FILE* in = fopen(path, "r");
+        if(in != NULL){
+        /*copy over the results of every other device*/
+                while(fscanf(in, "%127s %u %u", name, &period, &buffer) == 3){
+                        if(0 != strcmp(name, device))
+                                fprintf(out, "%s %u %u\n", name, period, buffer);
+                }
+                fclose(in);
+        }
+
+        fprintf(out, "%s %u %u\n", device, periodTime, bufferTime);
+
+        if(fclose(out) != 0 || rename(tmpPath, path) < 0){
+        /*replace the store in one step so a crash can't leave it half
+        * written*/
+                LOGMSG(LOG_ERR, "Failed to write %s: %m", path);
+                return 0;
+        }
+
+        return 1;
+}
+
+/***************************************************************************
+* int probeLatency(Sound_Device *dev, uint* xruns, long* minMargin)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Plays bursts like the audio thread does
+* Description: Function that opens the PCM device with the target period and
+*       buffer times of dev and plays it the way the audio thread does, in
+*       bursts of CALIBRATE_BURST that each start from an empty buffer and
+*       are drained, with CALIBRATE_GAP idle in between, for CALIBRATE_TIME.
+*       It measures the underruns, and how little was left in the device
+*       whenever the writer got back to it.
+*
+* Parameters:
+*        dev            I/O     Sound_Device*   The struct containing ALSA PCM
+*                                               handle and properties
+*        xruns          I/O     uint*           Number of underruns that
+*                                               occured
+*        minMargin      I/O     long*           Fewest frames left to play
+*                                               before a write
+*        probeLatency   O/P     int             Bool-type return value of
+*                                               whether the device opened
+**************************************************************************/
+int probeLatency(Sound_Device *dev, uint* xruns, long* minMargin)
+{
+        *xruns = 0;
+        *minMargin = 0;
+        dev->pcm_Handle = NULL;
+
+        if(setup(dev) == 0){
+                if(dev->pcm_Handle != NULL)
+                        snd_pcm_close(dev->pcm_Handle);
+                dev->pcm_Handle = NULL;
+                return 0;
+        }
+
+        wavByte_t* silence = (wavByte_t*) calloc(1, dev->buff_size);
+        /*a single period of silence*/
+        if(silence == NULL){
+                snd_pcm_close(dev->pcm_Handle);
+                dev->pcm_Handle = NULL;
+                return 0;
+        }
+
+        uint periodTime = dev->periodTime ? dev->periodTime : 1;
+        uint periods = (CALIBRATE_BURST + periodTime - 1) / periodTime;
+        uint bursts = CALIBRATE_TIME / (CALIBRATE_BURST + CALIBRATE_GAP);
+        struct timespec gap = {0, CALIBRATE_GAP * 1000L};
+        long margin = (long)dev->bufferFrames;
+
+        for(uint b = 0; b < bursts; b++){
+                for(uint i = 0; i < periods; i++){
+                        if(snd_pcm_state(dev->pcm_Handle) == SND_PCM_STATE_RUNNING){
+                        /*the device starts after the first period, as it does
+                        * for a ding, so from then on see how close it came to
+                        * running dry*/
+                                snd_pcm_sframes_t avail =
+                                        snd_pcm_avail_update(dev->pcm_Handle);
+                                if(avail >= 0
+                                        && (long)dev->bufferFrames - avail < margin)
+                                        margin = (long)dev->bufferFrames - avail;
+                        }
+
+                        snd_pcm_sframes_t ret = snd_pcm_writei(dev->pcm_Handle,
+                                                        silence, dev->frames);
+                        if(ret == -EPIPE){
+                        /*the device ran dry before the period was written*/
+                                (*xruns)++;
+                                snd_pcm_recover(dev->pcm_Handle, ret, 1);
+                        }
+                        else if(ret < 0
+                                && snd_pcm_recover(dev->pcm_Handle, ret, 1) < 0){
+                                (*xruns)++;
+                                b = bursts;
+                                break;
+                        }
+                }
+
+                snd_pcm_drain(dev->pcm_Handle);
+                snd_pcm_prepare(dev->pcm_Handle);
+                /*finish the burst as the audio thread does, then go idle*/
+                nanosleep(&gap, NULL);
+        }
+        *minMargin = margin;
+
+        free(silence);
+        snd_pcm_drop(dev->pcm_Handle);
+        snd_pcm_close(dev->pcm_Handle);
+        dev->pcm_Handle = NULL;
+        /*the probe only measures, the final configuration is opened later*/
+
+        return 1;
+}
+
+/***************************************************************************
+* void calibrateLatency(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Rejects configurations that nearly run dry
+* Description: Function that sets the target period and buffer times of the
+*       device to the smallest stable configuration. Progressively smaller
+*       periods are probed until one underruns or comes within
+*       1/CALIBRATE_MARGIN of a period of doing so, and the last stable one
+*       is stored. A result stored by an earlier start is looked up by the
+*       load task, which skips calibrating altogether. The
+*       result is stored under the device that was asked for, which is what
+*       the next start looks up, even if a busy direct device fell back to
+*       the default one. If the probes don't all open the same device the
+*       results can't be compared, so nothing is stored.
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The struct containing ALSA PCM handle
+*                                       and properties
+**************************************************************************/
+void calibrateLatency(Sound_Device *dev)
+{
+        uint bestPeriod = 0, bestBuffer = 0;
+        uint lastPeriod = 0;
+        /*the last period the device actually negotiated*/
+        const char* probed = NULL;
+        /*the device the first probe opened*/
+
+        for(size_t i = 0;
+                i < sizeof(g_calibratePeriods)/sizeof(g_calibratePeriods[0]);
+                i++){
+
+                uint xruns;
+                long minMargin;
+
+                dev->periodTime = g_calibratePeriods[i];
+                dev->bufferTime = g_calibratePeriods[i] * CALIBRATE_PERIODS;
+
+                if(!probeLatency(dev, &xruns, &minMargin)){
+                        LOGMSG(LOG_NOTICE, "Calibration: %u us rejected\n",
+                                g_calibratePeriods[i]);
+                        break;
+                }
+                if(probed == NULL)
+                        probed = dev->openedName;
+                else if(strcmp(probed, dev->openedName) != 0){
+                /*this probe fell back to another device, or the direct one
+                * came free*/
+                        LOGMSG(LOG_ALERT, "Calibration of %s switched from %s "
+                                "to %s, not storing it\n", dev->deviceName,
+                                probed, dev->openedName);
+                        bestPeriod = 0;
+                        break;
+                }
+
+                LOGMSG(LOG_NOTICE,
+                        "Calibration: period %u us, buffer %u us, "
+                        "%u xruns, min margin %ld frames\n",
+                        dev->periodTime, dev->bufferTime, xruns, minMargin);
+
+                if(xruns > 0
+                        || minMargin < (long)dev->frames / CALIBRATE_MARGIN)
+                /*this configuration is unstable, or close enough to it that
+                * it will be under load, so any smaller one will be too*/
+                        break;
+
+                if(dev->periodTime == lastPeriod)
+                /*the device can't go any smaller than this*/
+                        break;
+
+                lastPeriod = dev->periodTime;
+                bestPeriod = dev->periodTime;
+                bestBuffer = dev->bufferTime;
+        }
+
+        if(bestPeriod == 0){
+        /*nothing was stable, keep the defaults and probe again next time*/
+                LOGMSG(LOG_ALERT, "Calibration of %s found no stable setting\n",
+                        dev->deviceName);
+                dev->periodTime = getConfigUInt("DINGER_PERIOD_US", PERIOD_TIME);
+                dev->bufferTime = getConfigUInt("DINGER_BUFFER_US", BUFFER_TIME);
+                return;
+        }
+
+        dev->periodTime = bestPeriod;
+        dev->bufferTime = bestBuffer;
+        LOGMSG(LOG_NOTICE,
+                "Calibrated %s (opened as %s): period %u us, buffer %u us\n",
+                dev->deviceName, probed, bestPeriod, bestBuffer);
+        storeLatency(dev->deviceName, bestPeriod, bestBuffer);
+        /*store it under the name loadLatency looks up*/
+}
+
+
+#endif // CALIBRATE_H_INCLUDED
@@ -0,0 +1,188 @@
+/***************************************************************************
+* File:  Mixer.h
+* Author:  SkibbleBip
+* Procedures:
+* mixSamples            -Function that adds one buffer of samples onto another
+*                               with saturation
+* mixerStart            -Function that starts playing a sound on a free voice
+* mixerRender           -Function that mixes the next period of every playing
+*                               voice
+***************************************************************************/
+
+#ifndef MIXER_H_INCLUDED
+#define MIXER_H_INCLUDED
+
+#include <stdint.h>
+
+#include "../main.h"
+#include "Sound.h"
+#include "Assets.h"
+
+#define         MAX_VOICES      8
+/*Most sounds that can play over each other at once*/
+
+
+/*Struct to contain a sound that is currently playing*/
+typedef struct {
+        const wavByte_t* data;
+        long int size;
+        long int offset;
+        /*how many bytes of the sound were already played*/
+        uint32_t seq;
+        /*sequence number of the lock change it is playing for*/
+} Voice;
+
+/*Struct to contain every sound that is currently playing*/
+typedef struct {
+        Voice voices[MAX_VOICES];
+        uint count;
+        uint stolen;
+        /*how many voices were cut off to make room for a new one*/
+        uint32_t lastSeq;
+        /*sequence number of the newest voice, for the probes*/
+} Mixer;
+
+
+/***************************************************************************
+* void mixSamples(wavByte_t* dst, const wavByte_t* src, long int samples,
+*                       snd_pcm_format_t format)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that adds the samples of src onto dst, clipping the
+*       result to the range of the format rather than letting it wrap
+*
+* Parameters:
+*        dst            I/O     wavByte_t*              The samples mixed into
+*        src            I/P     const wavByte_t*        The samples to add
+*        samples        I/P     long int                Number of samples
+*        format         I/P     snd_pcm_format_t        The sample format
+**************************************************************************/
+void mixSamples(wavByte_t* dst, const wavByte_t* src, long int samples,
+                        snd_pcm_format_t format)
+{
+        switch(format){
+        case SND_PCM_FORMAT_S16_LE:{
+                int16_t* d = (int16_t*)dst;
+                const int16_t* s = (const int16_t*)src;
+                for(long int i = 0; i < samples; i++){
+                        int32_t v = (int32_t)d[i] + s[i];
+                        d[i] = v > INT16_MAX ? INT16_MAX
+                                : v < INT16_MIN ? INT16_MIN : (int16_t)v;
+                }
+                break;
+        }
+        case SND_PCM_FORMAT_S32_LE:{
+                int32_t* d = (int32_t*)dst;
+                const int32_t* s = (const int32_t*)src;
+                for(long int i = 0; i < samples; i++){
+                        int64_t v = (int64_t)d[i] + s[i];
+                        d[i] = v > INT32_MAX ? INT32_MAX
+                                : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+                }
+                break;
+        }
+        case SND_PCM_FORMAT_FLOAT_LE:{
+                float* d = (float*)dst;
+                const float* s = (const float*)src;
+                for(long int i = 0; i < samples; i++){
+                        float v = d[i] + s[i];
+                        d[i] = v > 1.0f ? 1.0f : v < -1.0f ? -1.0f : v;
+                }
+                break;
+        }
+        default:
+                break;
+        }
+}
+
+/***************************************************************************
+* void mixerStart(Mixer* m, const Sound_Asset* asset, uint32_t seq)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that starts playing a sound on a free voice. If every
+*       voice is busy, the one that has played the longest is replaced.
+*
+* Parameters:
+*        m      I/O     Mixer*                  The mixer
+*        asset  I/P     const Sound_Asset*      The sound to start
+*        seq    I/P     uint32_t                Sequence number of the lock
+*                                               change
+**************************************************************************/
+void mixerStart(Mixer* m, const Sound_Asset* asset, uint32_t seq)
+{
+        Voice* v;
+
+        if(m->count < MAX_VOICES){
+                v = &m->voices[m->count++];
+        }
+        else{
+        /*steal the voice that is furthest through its sound*/
+                v = &m->voices[0];
+                for(uint i = 1; i < m->count; i++){
+                        if(m->voices[i].offset > v->offset)
+                                v = &m->voices[i];
+                }
+                m->stolen++;
+        }
+
+        v->data = asset->data;
+        v->size = asset->size;
+        v->offset = 0;
+        v->seq = seq;
+        m->lastSeq = seq;
+}
+
+/***************************************************************************
+* long int mixerRender(Mixer* m, wavByte_t* out, long int frames,
+*                       Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that mixes up to one period of every playing voice
+*       into the output buffer and moves each voice along. Voices that reach
+*       the end of their sound are freed.
+*
+* Parameters:
+*        m              I/O     Mixer*          The mixer
+*        out            I/O     wavByte_t*      Buffer of at least frames
+*        frames         I/P     long int        Most frames to render
+*        dev            I/P     Sound_Device*   The opened PCM device
+*        mixerRender    O/P     long int        Number of frames rendered, 0
+*                                               if nothing is playing
+**************************************************************************/
+long int mixerRender(Mixer* m, wavByte_t* out, long int frames,
+                        Sound_Device *dev)
+{
+        long int rendered = 0;
+        long int maxBytes = frames * dev->frameBytes;
+        uint samplesPerFrame = dev->channels;
+
+        for(uint i = 0; i < m->count; i++){
+                Voice* v = &m->voices[i];
+                long int bytes = v->size - v->offset;
+                if(bytes > maxBytes)
+                        bytes = maxBytes;
+
+                if(bytes > rendered * (long int)dev->frameBytes){
+                /*clear the part of the buffer no voice has reached yet*/
+                        memset(out + rendered * dev->frameBytes, 0,
+                                bytes - rendered * dev->frameBytes);
+                        rendered = bytes / dev->frameBytes;
+                }
+                mixSamples(out, v->data + v->offset,
+                        bytes / dev->frameBytes * samplesPerFrame, dev->format);
+                v->offset += bytes;
+        }
+
+        for(uint i = 0; i < m->count; ){
+        /*free the voices that have finished*/
+                if(m->voices[i].offset >= m->voices[i].size)
+                        m->voices[i] = m->voices[--m->count];
+                else
+                        i++;
+        }
+
+        return rendered;
+}
+
+
+#endif // MIXER_H_INCLUDED
@@ -0,0 +1,428 @@
+/***************************************************************************
+* File:  Output.h
+* Author:  SkibbleBip
+* The outputs the sound can be written to, chosen with DINGER_OUTPUT: the ALSA
+* PCM device, a null output that only counts and timestamps what it is given,
+* and a capture output that writes exactly what would have been played to a
+* WAV (or headerless .raw) file. The last two open no sound device, so the
+* dingers can run and be measured on machines without one.
+* Procedures:
+* countWrite            -Function that counts and timestamps a write
+* alsaWrite             -Function that writes frames to the PCM device,
+*                               recovering it if the write fails
+* alsaDrain             -Function that plays out the PCM device and prepares
+*                               it for the next sound
+* alsaClose             -Function that closes the PCM device
+* setupFixed            -Function that sets the fixed format of the outputs
+*                               that aren't a device
+* nullOpen              -Function that opens the null output
+* nullWrite             -Function that takes frames and throws them away
+* nullClose             -Function that reports what the null output took
+* writeWavHeader        -Function that writes the WAV header of the capture
+* captureOpen           -Function that creates the capture file
+* captureWrite          -Function that appends frames to the capture file
+* captureClose          -Function that closes the capture file
+* sinkDrain             -Function that does nothing, for outputs with nothing
+*                               to play out
+* selectOutput          -Function that picks the output from DINGER_OUTPUT
+***************************************************************************/
+
+#ifndef OUTPUT_H_INCLUDED
+#define OUTPUT_H_INCLUDED
+
+#include <fcntl.h>
+
+#include "../main.h"
+#include "Sound.h"
+#include "Recovery.h"
+
+#define         CAPTURE_FILE    "dinger-capture.wav"
+/*Default name of the capture file in the runtime directory
+* (DINGER_CAPTURE_FILE)*/
+#define         WAV_HEADER      44
+/*Size of a canonical WAV header*/
+
+
+/*Struct to contain an output. write returns whether the sounds can carry on,
+* which they can't once the device had to be reopened*/
+struct Output_Sink {
+        const char* name;
+        int (*open)(Sound_Device *dev);
+        int (*write)(Sound_Device *dev, const wavByte_t* buffer, long int frames);
+        void (*drain)(Sound_Device *dev);
+        void (*close)(Sound_Device *dev);
+};
+
+
+/***************************************************************************
+* void countWrite(Sound_Device *dev, long int frames)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that counts the frames an output took, and when
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The output
+*        frames I/P     long int        Number of frames
+**************************************************************************/
+void countWrite(Sound_Device *dev, long int frames)
+{
+        dev->sinkFrames += frames;
+        dev->sinkWrites++;
+        dev->sinkWriteNs = getBoottimeNs();
+}
+
+/***************************************************************************
+* int alsaWrite(Sound_Device *dev, const wavByte_t* buffer, long int frames)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes frames to the PCM device, recovering it
+*       and writing the rest again if the write fails
+*
+* Parameters:
+*        dev            I/O     Sound_Device*           The PCM device
+*        buffer         I/P     const wavByte_t*        The frames
+*        frames         I/P     long int                Number of frames
+*        alsaWrite      O/P     int     Bool-type return value of whether the
+*                                       sounds can carry on playing
+**************************************************************************/
+int alsaWrite(Sound_Device *dev, const wavByte_t* buffer, long int frames)
+{
+        long int done = 0;
+
+        while(done < frames){
+                snd_pcm_sframes_t ret = snd_pcm_writei(dev->pcm_Handle,
+                                        buffer + done * dev->frameBytes,
+                                        frames - done);
+                if(ret < 0){
+                /*If the write failed, recover the device and write the same
+                * data again. If the device had to be reopened the sounds
+                * were converted again, so they can't carry on*/
+                        if(recoverPCM(dev, ret) != 1)
+                                return 0;
+                        continue;
+                }
+                done += ret;
+        }
+
+        countWrite(dev, frames);
+        return 1;
+}
+
+/***************************************************************************
+* void alsaDrain(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that plays out what is left in the PCM device and
+*       prepares it for the next sound
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The PCM device
+**************************************************************************/
+void alsaDrain(Sound_Device *dev)
+{
+        int err = snd_pcm_drain(dev->pcm_Handle);
+        if(err < 0)
+                recoverPCM(dev, err);
+        err = snd_pcm_prepare(dev->pcm_Handle);
+        if(err < 0)
+                recoverPCM(dev, err);
+}
+
+/***************************************************************************
+* void alsaClose(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes the PCM device
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The PCM device
+**************************************************************************/
+void alsaClose(Sound_Device *dev)
+{
+        if(dev->pcm_Handle != NULL)
+                snd_pcm_close(dev->pcm_Handle);
+        dev->pcm_Handle = NULL;
+        g_pcmHandle = NULL;
+}
+
+/***************************************************************************
+* void setupFixed(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sets the format of an output that isn't a
+*       device: 16 bit mono at the rate of the sounds, with the period and
+*       buffer times that were asked for
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The output
+**************************************************************************/
+void setupFixed(Sound_Device *dev)
+{
+        dev->format = g_pcmFormats[0];
+        dev->channels = CHANNELS;
+        dev->rate = RATE;
+        dev->frames = (snd_pcm_uframes_t)dev->rate * dev->periodTime / 1000000;
+        if(dev->frames == 0)
+                dev->frames = 1;
+        dev->bufferFrames = (snd_pcm_uframes_t)dev->rate * dev->bufferTime
+                                / 1000000;
+        dev->frameBytes = dev->channels
+                        * (snd_pcm_format_physical_width(dev->format) / 8);
+        dev->buff_size = dev->frames * dev->frameBytes;
+        dev->openedName = dev->sink->name;
+        dev->direct = 0;
+}
+
+/***************************************************************************
+* int nullOpen(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that opens the null output, which has nothing to
+*       open
+*
+* Parameters:
+*        dev            I/O     Sound_Device*   The output
+*        nullOpen       O/P     int             Always 1
+**************************************************************************/
+int nullOpen(Sound_Device *dev)
+{
+        setupFixed(dev);
+        LOGMSG(LOG_NOTICE, "Playing to the null output, %u Hz, period %lu frames\n",
+                dev->rate, dev->frames);
+        return 1;
+}
+
+/***************************************************************************
+* int nullWrite(Sound_Device *dev, const wavByte_t* buffer, long int frames)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that takes frames and throws them away. It returns at
+*       once, so the time to here is all the dinger's own.
+*
+* Parameters:
+*        dev            I/O     Sound_Device*           The output
+*        buffer         I/P     const wavByte_t*        The frames
+*        frames         I/P     long int                Number of frames
+*        nullWrite      O/P     int                     Always 1
+**************************************************************************/
+int nullWrite(Sound_Device *dev, const wavByte_t* buffer, long int frames)
+{
+        (void)buffer;
+        countWrite(dev, frames);
+        return 1;
+}
+
+/***************************************************************************
+* void nullClose(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reports what the null output took
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The output
+**************************************************************************/
+void nullClose(Sound_Device *dev)
+{
+        LOGMSG(LOG_NOTICE, "Null output took %llu frames in %u writes\n",
+                (unsigned long long)dev->sinkFrames, dev->sinkWrites);
+}
+
+/***************************************************************************
+* int writeWavHeader(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes the WAV header of the capture file for
+*       the frames captured so far. It is rewritten after every write, so the
+*       file is complete even if the dinger is killed.
+*
+* Parameters:
+*        dev            I/O     Sound_Device*   The capture output
+*        writeWavHeader O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int writeWavHeader(Sound_Device *dev)
+{
+        unsigned char h[WAV_HEADER];
+        uint32_t dataSize = (uint32_t)(dev->sinkFrames * dev->frameBytes);
+        uint32_t riffSize = dataSize + WAV_HEADER - 8;
+        uint16_t tag = snd_pcm_format_float(dev->format) ? 3 : 1;
+        /*IEEE float or integer PCM*/
+        uint16_t channels = dev->channels;
+        uint32_t rate = dev->rate;
+        uint32_t byteRate = dev->rate * dev->frameBytes;
+        uint16_t blockAlign = dev->frameBytes;
+        uint16_t bits = snd_pcm_format_physical_width(dev->format);
+        uint32_t fmtSize = 16;
+
+        memcpy(h, "RIFF", 4);
+        memcpy(h + 4, &riffSize, 4);
+        memcpy(h + 8, "WAVEfmt ", 8);
+        memcpy(h + 16, &fmtSize, 4);
+        memcpy(h + 20, &tag, 2);
+        memcpy(h + 22, &channels, 2);
+        memcpy(h + 24, &rate, 4);
+        memcpy(h + 28, &byteRate, 4);
+        memcpy(h + 32, &blockAlign, 2);
+        memcpy(h + 34, &bits, 2);
+        memcpy(h + 36, "data", 4);
+        memcpy(h + 40, &dataSize, 4);
+        /*the fields are little endian, as is every machine this runs on*/
+
+        return pwrite(dev->captureFd, h, sizeof(h), 0) == sizeof(h);
+}
+
+/***************************************************************************
+* int captureOpen(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that creates the capture file, named by
+*       DINGER_CAPTURE_FILE or in the runtime directory. A name ending in
+*       .raw gets the bare samples without a WAV header.
+*
+* Parameters:
+*        dev            I/O     Sound_Device*   The output
+*        captureOpen    O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int captureOpen(Sound_Device *dev)
+{
+        char path[200];
+        const char* name = getenv("DINGER_CAPTURE_FILE");
+
+        if(name != NULL && *name != '\000')
+                snprintf(path, sizeof(path), "%s", name);
+        else{
+                const char* dir = getenv("XDG_RUNTIME_DIR");
+                snprintf(path, sizeof(path), "%s/%s",
+                        dir != NULL ? dir : "/tmp", CAPTURE_FILE);
+        }
+
+        setupFixed(dev);
+        dev->captureFd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,
+                                S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+        if(dev->captureFd < 0){
+                LOGMSG(LOG_ERR, "Failed to create capture file %s: %m", path);
+                return 0;
+        }
+
+        size_t len = strlen(path);
+        dev->captureWav = len < 4 || strcmp(path + len - 4, ".raw") != 0;
+        if(dev->captureWav && !writeWavHeader(dev)){
+                LOGMSG(LOG_ERR, "Failed to write capture file %s: %m", path);
+                close(dev->captureFd);
+                dev->captureFd = -1;
+                return 0;
+        }
+
+        LOGMSG(LOG_NOTICE, "Capturing to %s, %s, %u channels, %u Hz\n", path,
+                snd_pcm_format_name(dev->format), dev->channels, dev->rate);
+        return 1;
+}
+
+/***************************************************************************
+* int captureWrite(Sound_Device *dev, const wavByte_t* buffer,
+*                       long int frames)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that appends frames to the capture file, exactly as
+*       they would have been written to the device
+*
+* Parameters:
+*        dev            I/O     Sound_Device*           The output
+*        buffer         I/P     const wavByte_t*        The frames
+*        frames         I/P     long int                Number of frames
+*        captureWrite   O/P     int                     Always 1, a failed
+*                                                       write is only logged
+**************************************************************************/
+int captureWrite(Sound_Device *dev, const wavByte_t* buffer, long int frames)
+{
+        size_t size = frames * dev->frameBytes;
+        off_t at = (dev->captureWav ? WAV_HEADER : 0)
+                        + (off_t)dev->sinkFrames * dev->frameBytes;
+        /*after the header and everything captured so far*/
+
+        if(dev->captureFd < 0)
+                return 1;
+        if(pwrite(dev->captureFd, buffer, size, at) != (ssize_t)size){
+                LOGMSG(LOG_ERR, "Failed to write capture file: %m");
+                return 1;
+        }
+        countWrite(dev, frames);
+        if(dev->captureWav)
+                writeWavHeader(dev);
+
+        return 1;
+}
+
+/***************************************************************************
+* void captureClose(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes the capture file
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The output
+**************************************************************************/
+void captureClose(Sound_Device *dev)
+{
+        if(dev->captureFd >= 0)
+                close(dev->captureFd);
+        dev->captureFd = -1;
+        LOGMSG(LOG_NOTICE, "Captured %llu frames in %u writes\n",
+                (unsigned long long)dev->sinkFrames, dev->sinkWrites);
+}
+
+/***************************************************************************
+* void sinkDrain(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that does nothing, as outputs that aren't a device
+*       have nothing to play out
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The output
+**************************************************************************/
+void sinkDrain(Sound_Device *dev)
+{
+        (void)dev;
+}
+
+
+const Output_Sink g_alsaSink = {"alsa", setup, alsaWrite, alsaDrain, alsaClose};
+const Output_Sink g_nullSink = {"null", nullOpen, nullWrite, sinkDrain, nullClose};
+const Output_Sink g_captureSink = {"capture", captureOpen, captureWrite,
+                                        sinkDrain, captureClose};
+const Output_Sink* g_outputSinks[] = {&g_alsaSink, &g_nullSink, &g_captureSink};
+
+
+/***************************************************************************
+* void selectOutput(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that picks the output named by DINGER_OUTPUT, which
+*       is the ALSA device unless it says otherwise
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The sound device
+**************************************************************************/
+void selectOutput(Sound_Device *dev)
+{
+        const char* name = getenv("DINGER_OUTPUT");
+
+        dev->sink = &g_alsaSink;
+        dev->captureFd = -1;
+        if(name == NULL || *name == '\000')
+                return;
+
+        for(size_t i = 0; i < sizeof(g_outputSinks) / sizeof(g_outputSinks[0]); i++){
+                if(strcmp(name, g_outputSinks[i]->name) == 0){
+                        dev->sink = g_outputSinks[i];
+                        LOGMSG(LOG_NOTICE, "Using the %s output\n", name);
+                        return;
+                }
+        }
+        LOGMSG(LOG_ALERT, "Unknown output %s, using alsa\n", name);
+}
+
+
+#endif // OUTPUT_H_INCLUDED
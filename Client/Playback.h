@@ -0,0 +1,270 @@
+/***************************************************************************
+* File:  Playback.h
+* Author:  SkibbleBip
+* Procedures:
+* setup                 -Function that prepares the ALSA PCM handle and
+*                               properties for playback
+* playSound             -Plays sound in accordance to the inputted byte array,
+*                               data size, and PCM device as params
+***************************************************************************/
+
+#ifndef PLAYBACK_H_INCLUDED
+#define PLAYBACK_H_INCLUDED
+
+#include "../main.h"
+#include "../Probes.h"
+#include "Sound.h"
+#include "Assets.h"
+#include "Recovery.h"
+#include "Output.h"
+
+
+/***************************************************************************
+* int setup(Sound_Device *dev)
+* Author: Skibblebip
+* Date: 05/20/2021
+* Description: Function that prepares the ALSA PCM handle and properties for
+*              playback
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The struct containing ALSA PCM handle
+*                                       and properties
+*        setup  O/P     int             Bool-type return value of whether there
+*                                       was a failure
+**************************************************************************/
+int setup(Sound_Device *dev){
+        uint rate = RATE;
+        /*obtain the temporary value of the rate*/
+        snd_pcm_sw_params_t *swParams;
+        /*software parameters of the PCM device*/
+        int direct = strcmp(dev->deviceName, PCM_DEVICE) != 0;
+        int err = snd_pcm_open(
+        /*open the playback device and return it to the pcm handle. A direct
+        * hw device blocks in open while another program holds it, so it is
+        * opened non-blocking to find out if it is busy*/
+                &(dev->pcm_Handle),
+                dev->deviceName,
+                SND_PCM_STREAM_PLAYBACK,
+                direct ? SND_PCM_NONBLOCK : 0
+                );
+        dev->openedName = dev->deviceName;
+
+        if(err < 0 && direct){
+        /*if the direct device is busy or missing, fall back to the default
+        * device*/
+                LOGMSG(LOG_NOTICE, "%s is unavailable (%s), falling back to %s\n",
+                        dev->deviceName, snd_strerror(err), PCM_DEVICE);
+                direct = 0;
+                dev->openedName = PCM_DEVICE;
+                err = snd_pcm_open(
+                        &(dev->pcm_Handle),
+                        PCM_DEVICE,
+                        SND_PCM_STREAM_PLAYBACK,
+                        0
+                        );
+        }
+        if(err < 0)
+                return 0;
+
+        if(direct && snd_pcm_nonblock(dev->pcm_Handle, 0) < 0)
+        /*writes to the device are blocking like the default device*/
+                return 0;
+        dev->direct = direct;
+
+        snd_pcm_hw_params_alloca(&(dev->params));
+        snd_pcm_hw_params_any(dev->pcm_Handle, dev->params);
+        /*Allocate parameters and apply them to the pcm device*/
+        if(snd_pcm_hw_params_set_access(
+        /*Set access mode for the PCM device*/
+                dev->pcm_Handle,
+                dev->params,
+                SND_PCM_ACCESS_RW_INTERLEAVED
+                ) < 0)
+		return 0;
+
+        dev->format = SND_PCM_FORMAT_UNKNOWN;
+        for(size_t i = 0; i < sizeof(g_pcmFormats)/sizeof(g_pcmFormats[0]); i++){
+        /*use the first format the device supports, the sounds are converted
+        * into it after the device is opened*/
+                if(snd_pcm_hw_params_test_format(
+                        dev->pcm_Handle,
+                        dev->params,
+                        g_pcmFormats[i]
+                        ) == 0){
+                        dev->format = g_pcmFormats[i];
+                        break;
+                }
+        }
+
+	if(dev->format == SND_PCM_FORMAT_UNKNOWN || snd_pcm_hw_params_set_format(
+	/*set format of the playback*/
+                dev->pcm_Handle,
+                dev->params,
+                dev->format
+                ) < 0)
+		return 0;
+
+        dev->channels = CHANNELS;
+	if(snd_pcm_hw_params_set_channels_near(
+	/*Set the channel number of the playback, devices that can't play mono
+        * will pick the nearest count they support*/
+                dev->pcm_Handle,
+                dev->params,
+                &(dev->channels)
+                ) < 0)
+		return 0;
+
+	if(snd_pcm_hw_params_set_rate_near(
+	/*Set the rate of the playback*/
+                dev->pcm_Handle,
+                dev->params,
+                &rate,
+                0
+                ) < 0)
+		return 0;
+
+        if(snd_pcm_hw_params_set_buffer_time_near(
+        /*Set the target length of the whole ring buffer. The plugin defaults
+        * are often 100ms or more, which is all latency for a one-shot ding*/
+                dev->pcm_Handle,
+                dev->params,
+                &(dev->bufferTime),
+                0
+                ) < 0)
+                return 0;
+
+        if(snd_pcm_hw_params_set_period_time_near(
+        /*Set the target length of a single period*/
+                dev->pcm_Handle,
+                dev->params,
+                &(dev->periodTime),
+                0
+                ) < 0)
+                return 0;
+
+
+	if(snd_pcm_hw_params(dev->pcm_Handle, dev->params) < 0)
+	/*Write parameters*/
+		return 0;
+
+
+        /*Allocate the buffer to hold a single period time length*/
+	snd_pcm_hw_params_get_period_size(dev->params, &(dev->frames), 0);
+        snd_pcm_hw_params_get_buffer_size(dev->params, &(dev->bufferFrames));
+        snd_pcm_hw_params_get_period_time(dev->params, &(dev->periodTime), 0);
+        snd_pcm_hw_params_get_buffer_time(dev->params, &(dev->bufferTime), 0);
+        dev->rate = rate;
+        /*read back the values the device actually negotiated*/
+
+        dev->frameBytes = dev->channels
+                        * (snd_pcm_format_physical_width(dev->format) / 8);
+	dev->buff_size = dev->frames * dev->frameBytes;
+	/*define the buffer size in accordance to the frames and channels size*/
+
+        snd_pcm_sw_params_alloca(&swParams);
+        if(snd_pcm_sw_params_current(dev->pcm_Handle, swParams) < 0)
+                return 0;
+
+        if(snd_pcm_sw_params_set_start_threshold(
+        /*Start playback as soon as the first period is written rather than
+        * waiting for the whole buffer to fill*/
+                dev->pcm_Handle,
+                swParams,
+                dev->frames
+                ) < 0)
+                return 0;
+
+        if(snd_pcm_sw_params_set_avail_min(
+        /*Wake the writer up as soon as a single period is free*/
+                dev->pcm_Handle,
+                swParams,
+                dev->frames
+                ) < 0)
+                return 0;
+
+        if(snd_pcm_sw_params(dev->pcm_Handle, swParams) < 0)
+        /*Write software parameters*/
+                return 0;
+
+        LOGMSG(LOG_NOTICE, "Playing through %s (%s path)\n",
+                dev->openedName, dev->direct ? "direct" : "default");
+        LOGMSG(LOG_NOTICE,
+                "PCM negotiated %s, %u channels, %u Hz, "
+                "period %lu frames (%u us), buffer %lu frames (%u us)\n",
+                snd_pcm_format_name(dev->format),
+                dev->channels,
+                dev->rate,
+                dev->frames,
+                dev->periodTime,
+                dev->bufferFrames,
+                dev->bufferTime
+                );
+
+	g_pcmHandle = dev->pcm_Handle;
+	/*set a global pointer to the PCM handle, this will be cleared */
+
+
+        return 1;
+}
+
+/***************************************************************************
+* void playSound(const unsigned char* sound, const long int size,Sound_Device *dev,
+*                       uint32_t seq)
+* Author: SkibbleBip
+* Date: 06/01/2021      v1: Initial
+* Date: 10/19/2026      v2: Fires the PCM write probes
+* Date: 10/19/2026      v3: Writes to the selected output
+* Date: 10/19/2026      v4: Ignores a partial frame at the end
+* Description: Plays sound in accordance to the inputted byte array, data size,
+*       and PCM device as params. A partial frame at the end is not played.
+*
+* Parameters:
+*        sound  I/P     const unsigned char*    Sound data char array
+*        size   I/P     const long int          Size of the data array
+*        dev    I/O     Sound_Device*           Struct containing the ALSA PCM
+*                                               handle and properties
+*        seq    I/P     uint32_t                Sequence number of the lock
+*                                               change, for the probes
+**************************************************************************/
+void playSound(const unsigned char* sound, const long int size,Sound_Device *dev,
+                uint32_t seq){
+        wavByte_t* buffer = (wavByte_t*) malloc(dev->buff_size);
+	long int c = 0;
+	uint bSize = dev->buff_size;
+	uint frms = dev->frames;
+	/*frame and buffer size must change as near the end of the audio stream
+	*the remaining WAV data will be too small to fit in the buffer, so the
+	*frame size and buffer size will be changed so the remaining audio isnt
+	*disorted
+	*/
+        const long int end = size - size % dev->frameBytes;
+        /*only whole frames can be written, a partial one at the end would
+        * never be stepped past*/
+        PROBE3(pcm_write_start, seq, size / dev->frameBytes, getBoottimeNs());
+	while(end > c){
+                if((end-c) < bSize){
+                /*If the remaining buffer size is smaller than the default,
+                * then change the frame size and buffer size*/
+                        bSize = end - c;
+                        frms = bSize / dev->frameBytes;
+                }
+                memcpy(buffer, sound+c, bSize);
+                /*copy the sound data into the buffer*/
+                if(!dev->sink->write(dev, buffer, frms))
+                /*If the device had to be reopened the sound was converted for
+                * the old device, so give up on it*/
+                        break;
+                c += frms * dev->frameBytes;
+
+	}
+
+        PROBE3(pcm_write_end, seq, c / dev->frameBytes, getBoottimeNs());
+        free(buffer);
+        //free the dynamic buffer
+
+
+
+}
+
+
+#endif // PLAYBACK_H_INCLUDED
@@ -0,0 +1,207 @@
+/***************************************************************************
+* File:  Queue.h
+* Author:  SkibbleBip
+* Procedures:
+* queueInit             -Function that prepares the command queue
+* queuePush             -Function that adds a play command to the queue, only
+*                               called from the IPC thread
+* queuePop              -Function that takes the oldest play command from the
+*                               queue, only called from the audio thread
+* queueWait             -Function that blocks the audio thread until a
+*                               command is pushed
+* queueReport           -Function that writes the queue statistics to syslog
+***************************************************************************/
+
+#ifndef QUEUE_H_INCLUDED
+#define QUEUE_H_INCLUDED
+
+#include <stdatomic.h>
+#include <semaphore.h>
+
+#include "../main.h"
+
+#define         QUEUE_SIZE      64
+/*Number of commands the queue holds, must be a power of 2*/
+#define         QUEUE_REPORT    100
+/*How many commands are played between each statistics report*/
+
+
+/*Struct to contain a command for the audio thread*/
+typedef struct {
+        Status_t status;
+        uint32_t seq;
+        /*sequence number the server gave the lock change*/
+        int64_t queuedNs;
+        /*when the command was pushed (CLOCK_BOOTTIME), to measure its age*/
+        uint64_t journalPos;
+        /*the journal entry of the lock change*/
+} Play_Command;
+
+/*Struct to contain the single producer single consumer ring. The head is only
+* written by the consumer and the tail only by the producer, so neither side
+* ever waits on the other*/
+typedef struct {
+        Play_Command commands[QUEUE_SIZE];
+        _Alignas(64) atomic_uint head;
+        /*next command to pop*/
+        _Alignas(64) atomic_uint tail;
+        /*next free slot to push into*/
+        sem_t doorbell;
+        /*counts pushed commands so the audio thread can sleep when idle*/
+
+        uint pushed;
+        uint dropped;
+        uint maxDepth;
+        /*producer statistics*/
+        uint popped;
+        int64_t totalAgeNs;
+        int64_t maxAgeNs;
+        /*consumer statistics*/
+} Command_Queue;
+
+
+/***************************************************************************
+* int queueInit(Command_Queue* q)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that prepares an empty command queue
+*
+* Parameters:
+*        q              I/O     Command_Queue*  The queue
+*        queueInit      O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int queueInit(Command_Queue* q)
+{
+        memset(q, 0, sizeof(*q));
+        atomic_init(&q->head, 0);
+        atomic_init(&q->tail, 0);
+        return sem_init(&q->doorbell, 0, 0) == 0;
+}
+
+/***************************************************************************
+* int queuePush(Command_Queue* q, Status_t status, uint32_t seq,
+*                       uint64_t journalPos)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that adds a play command to the queue. It never
+*       blocks; if the queue is full the command is dropped and counted.
+*
+* Parameters:
+*        q              I/O     Command_Queue*  The queue
+*        status         I/P     Status_t        The lock change to play
+*        seq            I/P     uint32_t        Its sequence number
+*        journalPos     I/P     uint64_t        Its journal entry
+*        queuePush      O/P     int             Bool-type return value of
+*                                               whether the command was queued
+**************************************************************************/
+int queuePush(Command_Queue* q, Status_t status, uint32_t seq,
+                uint64_t journalPos)
+{
+        uint tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        uint head = atomic_load_explicit(&q->head, memory_order_acquire);
+        uint depth = tail - head;
+
+        if(depth >= QUEUE_SIZE){
+        /*the audio thread has fallen too far behind*/
+                q->dropped++;
+                return 0;
+        }
+
+        Play_Command* cmd = &q->commands[tail & (QUEUE_SIZE - 1)];
+        cmd->status = status;
+        cmd->seq = seq;
+        cmd->queuedNs = getBoottimeNs();
+        cmd->journalPos = journalPos;
+        atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+        /*publish the command only once it is written*/
+
+        q->pushed++;
+        if(depth + 1 > q->maxDepth)
+                q->maxDepth = depth + 1;
+
+        sem_post(&q->doorbell);
+        return 1;
+}
+
+/***************************************************************************
+* int queuePop(Command_Queue* q, Play_Command* out)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that takes the oldest command off the queue without
+*       blocking, and records how long it waited
+*
+* Parameters:
+*        q              I/O     Command_Queue*  The queue
+*        out            I/O     Play_Command*   The command that was taken
+*        queuePop       O/P     int             Bool-type return value of
+*                                               whether there was a command
+**************************************************************************/
+int queuePop(Command_Queue* q, Play_Command* out)
+{
+        uint head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        uint tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+        if(head == tail)
+                return 0;
+
+        *out = q->commands[head & (QUEUE_SIZE - 1)];
+        atomic_store_explicit(&q->head, head + 1, memory_order_release);
+        /*hand the slot back to the producer*/
+
+        int64_t age = getBoottimeNs() - out->queuedNs;
+        q->popped++;
+        q->totalAgeNs += age;
+        if(age > q->maxAgeNs)
+                q->maxAgeNs = age;
+
+        return 1;
+}
+
+/***************************************************************************
+* void queueWait(Command_Queue* q)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that blocks the audio thread until at least one
+*       command has been pushed. Commands may already have been popped by the
+*       time it returns, so the caller pops until the queue is empty.
+*
+* Parameters:
+*        q      I/O     Command_Queue*  The queue
+**************************************************************************/
+void queueWait(Command_Queue* q)
+{
+        while(sem_wait(&q->doorbell) < 0 && errno == EINTR)
+                ;
+        while(sem_trywait(&q->doorbell) == 0)
+        /*one wake up covers every command waiting*/
+                ;
+}
+
+/***************************************************************************
+* void queueReport(Command_Queue* q)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes the depth and age statistics of the queue
+*       to syslog. The producer counters are read without synchronisation, so
+*       they may be slightly behind.
+*
+* Parameters:
+*        q      I/P     Command_Queue*  The queue
+**************************************************************************/
+void queueReport(Command_Queue* q)
+{
+        LOGMSG(LOG_NOTICE,
+                "Audio queue: %u pushed, %u played, %u dropped, max depth %u, "
+                "average age %lld us, max age %lld us\n",
+                q->pushed,
+                q->popped,
+                q->dropped,
+                q->maxDepth,
+                (long long)(q->popped ? q->totalAgeNs / q->popped / 1000 : 0),
+                (long long)(q->maxAgeNs / 1000)
+                );
+}
+
+
+#endif // QUEUE_H_INCLUDED
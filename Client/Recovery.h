@@ -0,0 +1,200 @@
+/***************************************************************************
+* File:  Recovery.h
+* Author:  SkibbleBip
+* Procedures:
+* waitForSoundDevice    -Function that blocks until the PCM device can be
+*                               opened again after it was lost
+* reopenPCM             -Function that closes a lost PCM device and opens it
+*                               again once it comes back
+* recoverPCM            -Function that recovers the PCM device from an error
+*                               returned by ALSA
+***************************************************************************/
+
+#ifndef RECOVERY_H_INCLUDED
+#define RECOVERY_H_INCLUDED
+
+#include <sys/inotify.h>
+#include <limits.h>
+
+#include "../main.h"
+#include "Sound.h"
+#include "Assets.h"
+
+#define         SND_DEV_DIR     "/dev/snd"
+#define         RESUME_WAIT     100000
+/*How long to wait in microseconds between attempts to resume a suspended
+* device*/
+
+
+/*Struct to contain the counters of each kind of recovery*/
+typedef struct {
+        uint xruns;
+        uint suspends;
+        uint reopens;
+        uint failures;
+        int64_t totalNs;
+        int64_t maxNs;
+} Recovery_Stats;
+
+Recovery_Stats g_recovery;
+
+
+/***************************************************************************
+* void waitForSoundDevice(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that blocks until the PCM device can be set up again,
+*       using inotify to sleep until something in /dev/snd is created or has
+*       its permissions changed, such as a USB headset being plugged back in
+*
+* Parameters:
+*        dev    I/O     Sound_Device*   The struct containing ALSA PCM handle
+*                                       and properties
+**************************************************************************/
+void waitForSoundDevice(Sound_Device *dev)
+{
+        const size_t buff_size = sizeof(struct inotify_event) + NAME_MAX + 1;
+        /*obtain the size of the inotify event*/
+        char event[buff_size];
+        int fd = inotify_init1(IN_CLOEXEC);
+        int wd = -1;
+
+        if(fd >= 0)
+                wd = inotify_add_watch(fd, SND_DEV_DIR, IN_CREATE|IN_ATTRIB);
+        /*the watch is added before the device is tried so that a device
+        * appearing in between is not missed*/
+
+        while(setup(dev) == 0){
+                if(dev->pcm_Handle != NULL)
+                        snd_pcm_close(dev->pcm_Handle);
+                dev->pcm_Handle = NULL;
+
+                if(wd < 0){
+                /*without inotify, fall back to trying once a second*/
+                        sleep(1);
+                        continue;
+                }
+                if(read(fd, event, buff_size) < 0 && errno != EINTR){
+                        LOGMSG(LOG_ERR, "Failed to watch %s: %m", SND_DEV_DIR);
+                        close(fd);
+                        fd = wd = -1;
+                }
+        }
+
+        if(fd >= 0)
+                close(fd);
+}
+
+/***************************************************************************
+* int reopenPCM(Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes a PCM device that has been lost and
+*       blocks until it can be opened again. If the device comes back with a
+*       different format the sounds are converted again
+*
+* Parameters:
+*        dev            I/O     Sound_Device*   The struct containing ALSA PCM
+*                                               handle and properties
+*        reopenPCM      O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int reopenPCM(Sound_Device *dev)
+{
+        snd_pcm_format_t format = dev->format;
+        uint channels = dev->channels;
+        uint rate = dev->rate;
+
+        LOGMSG(LOG_ALERT, "Lost sound device %s, waiting for it to return\n",
+                dev->openedName);
+        if(dev->pcm_Handle != NULL)
+                snd_pcm_close(dev->pcm_Handle);
+        dev->pcm_Handle = NULL;
+        g_pcmHandle = NULL;
+
+        waitForSoundDevice(dev);
+
+        if(format != dev->format || channels != dev->channels
+                || rate != dev->rate){
+        /*the new device negotiated something else, so the sounds need to be
+        * converted again*/
+                freeAssets();
+                return prepareAssets(dev);
+        }
+
+        return 1;
+}
+
+/***************************************************************************
+* int recoverPCM(Sound_Device *dev, int err)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that recovers the PCM device from an error returned by
+*       ALSA. Underruns are prepared again, suspended devices are resumed and
+*       lost devices are reopened. Each recovery is counted and timed.
+*
+* Parameters:
+*        dev            I/O     Sound_Device*   The struct containing ALSA PCM
+*                                               handle and properties
+*        err            I/P     int             The negative error code
+*        recoverPCM     O/P     int             1 if the stream can carry on,
+*                                               2 if the device was reopened
+*                                               and 0 on failure
+**************************************************************************/
+int recoverPCM(Sound_Device *dev, int err)
+{
+        int64_t start = getMonotonicNs();
+        int ret = 1;
+
+        if(err == -EPIPE){
+        /*underrun, the device ran dry*/
+                g_recovery.xruns++;
+                if(snd_pcm_recover(dev->pcm_Handle, err, 1) < 0)
+                        ret = reopenPCM(dev) ? 2 : 0;
+        }
+        else if(err == -ESTRPIPE){
+        /*the system was suspended, wait until the device can be resumed*/
+                g_recovery.suspends++;
+                int r;
+                while((r = snd_pcm_resume(dev->pcm_Handle)) == -EAGAIN)
+                        usleep(RESUME_WAIT);
+                if(r < 0 && snd_pcm_prepare(dev->pcm_Handle) < 0)
+                /*the device can't resume, so restart it instead*/
+                        ret = reopenPCM(dev) ? 2 : 0;
+        }
+        else if(err == -ENODEV || err == -EBADFD){
+        /*the device was unplugged*/
+                g_recovery.reopens++;
+                ret = reopenPCM(dev) ? 2 : 0;
+        }
+        else if(snd_pcm_recover(dev->pcm_Handle, err, 1) < 0){
+        /*anything else is tried once, and reopened if that fails*/
+                g_recovery.reopens++;
+                ret = reopenPCM(dev) ? 2 : 0;
+        }
+
+        if(ret == 0)
+                g_recovery.failures++;
+
+        int64_t took = getMonotonicNs() - start;
+        g_recovery.totalNs += took;
+        if(took > g_recovery.maxNs)
+                g_recovery.maxNs = took;
+
+        LOGMSG(LOG_NOTICE,
+                "Recovered from %s in %lld us (xruns %u, suspends %u, "
+                "reopens %u, failures %u, max %lld us)\n",
+                snd_strerror(err),
+                (long long)(took / 1000),
+                g_recovery.xruns,
+                g_recovery.suspends,
+                g_recovery.reopens,
+                g_recovery.failures,
+                (long long)(g_recovery.maxNs / 1000)
+                );
+
+        return ret;
+}
+
+
+#endif // RECOVERY_H_INCLUDED
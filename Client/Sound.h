@@ -0,0 +1,72 @@
+/***************************************************************************
+* File:  Sound.h
+* Author:  SkibbleBip
+* Definition of the ALSA PCM device properties shared between the client's
+* playback and calibration code, and the outputs
+***************************************************************************/
+
+#ifndef SOUND_H_INCLUDED
+#define SOUND_H_INCLUDED
+
+#include <alsa/asoundlib.h>
+
+#define         PCM_DEVICE      "default"
+#define         RATE            44100
+#define         CHANNELS        1
+#define         PERIOD_TIME     5000
+/*Default target period time in microseconds (DINGER_PERIOD_US)*/
+#define         BUFFER_TIME     20000
+/*Default target buffer time in microseconds (DINGER_BUFFER_US)*/
+
+const snd_pcm_format_t g_pcmFormats[] = {
+        SND_PCM_FORMAT_S16_LE,
+        SND_PCM_FORMAT_S32_LE,
+        SND_PCM_FORMAT_FLOAT_LE
+};
+/*The sample formats the sounds can be converted to, in order of preference*/
+
+
+typedef struct Output_Sink Output_Sink;
+/*Where the sound goes, defined in Output.h*/
+
+/*Struct to contain the properties of the ALSA API PCM handles*/
+typedef struct {
+        snd_pcm_t *pcm_Handle;
+        snd_pcm_hw_params_t *params;
+        snd_pcm_uframes_t frames;
+        snd_pcm_uframes_t bufferFrames;
+        const char* deviceName;
+        /*the device that was asked for (DINGER_PCM_DEVICE)*/
+        const char* openedName;
+        /*the device that was actually opened*/
+        int direct;
+        /*whether the device bypasses the default sound server path*/
+        snd_pcm_format_t format;
+        uint channels;
+        uint frameBytes;
+        uint periodTime;
+        uint bufferTime;
+        uint rate;
+        uint buff_size;
+        const Output_Sink* sink;
+        /*the output the sound is written to (DINGER_OUTPUT)*/
+        int captureFd;
+        int captureWav;
+        /*the file of the capture output, and whether it has a WAV header*/
+        uint64_t sinkFrames;
+        uint sinkWrites;
+        int64_t sinkWriteNs;
+        /*frames and writes taken by the output, and when it last took one*/
+} Sound_Device;
+
+snd_pcm_t *g_pcmHandle;
+/*global pointer to the opened PCM handle for the shutdown handlers*/
+
+
+/*Definitions of functions*/
+int setup(Sound_Device *dev);
+void playSound(const unsigned char* sound, const long int size, Sound_Device *dev,
+                uint32_t seq);
+
+
+#endif // SOUND_H_INCLUDED
@@ -0,0 +1,86 @@
+/***************************************************************************
+* File:  Startup.h
+* Author:  SkibbleBip
+* Procedures:
+* markPhase             -Function that records the time a startup phase was
+*                               reached
+* dumpTimeline          -Function that writes the startup timeline to syslog
+***************************************************************************/
+
+#ifndef STARTUP_H_INCLUDED
+#define STARTUP_H_INCLUDED
+
+#include <stdatomic.h>
+
+#include "../main.h"
+
+#define         MAX_PHASES      32
+/*Most startup phases that are recorded*/
+
+
+/*Struct to contain a single point on the startup timeline*/
+typedef struct {
+        const char* name;
+        int64_t ns;
+} Startup_Phase;
+
+Startup_Phase g_phases[MAX_PHASES];
+atomic_uint g_phaseCount;
+/*The phases, which may be recorded from several startup threads at once*/
+int64_t g_startupNs;
+/*when the client started*/
+
+
+/***************************************************************************
+* void markPhase(const char* name)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that records the time a startup phase was reached.
+*       The first phase marked is the start of the timeline.
+*
+* Parameters:
+*        name   I/P     const char*     Name of the phase, must be a literal
+**************************************************************************/
+void markPhase(const char* name)
+{
+        int64_t now = getMonotonicNs();
+        uint i = atomic_fetch_add(&g_phaseCount, 1);
+        /*claim a slot, so threads never write the same one*/
+        if(i >= MAX_PHASES)
+                return;
+        if(i == 0)
+                g_startupNs = now;
+        g_phases[i].ns = now;
+        g_phases[i].name = name;
+}
+
+/***************************************************************************
+* void dumpTimeline(const char* reason)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes every recorded phase to syslog along with
+*       how long after the start it was reached. There are more phases than
+*       one call site may log at once, so the lines aren't rate limited.
+*
+* Parameters:
+*        reason I/P     const char*     Why the timeline is being written
+**************************************************************************/
+void dumpTimeline(const char* reason)
+{
+        uint count = atomic_load(&g_phaseCount);
+        if(count > MAX_PHASES)
+                count = MAX_PHASES;
+
+        LOGMSG(LOG_NOTICE, "Startup timeline (%s):\n", reason);
+        for(uint i = 0; i < count; i++){
+                if(g_phases[i].name == NULL)
+                /*the slot was claimed but isn't written yet*/
+                        continue;
+                LOGMSG_ALL(LOG_NOTICE, "  %8lld us  %s\n",
+                        (long long)((g_phases[i].ns - g_startupNs) / 1000),
+                        g_phases[i].name);
+        }
+}
+
+
+#endif // STARTUP_H_INCLUDED
@@ -0,0 +1,205 @@
+/***************************************************************************
+* File:  Utmp.h
+* Author:  SkibbleBip
+* Procedures:
+* utmpWatchInit         -Function that resolves the user's name and opens the
+*                               utmp file
+* utmpMatches           -Function that checks if a utmp record is a login of
+*                               the watched user
+* utmpWatchUpdate       -Function that parses only the appended or changed
+*                               utmp records and returns if the user is
+*                               logged in
+* utmpWatchClose        -Function that closes the utmp file and reports the
+*                               time spent on it
+***************************************************************************/
+
+#ifndef UTMP_H_INCLUDED
+#define UTMP_H_INCLUDED
+
+#include <utmp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+
+#include "../main.h"
+
+
+/*Struct to contain the state of the incremental utmp scanner*/
+typedef struct {
+        char user[UT_NAMESIZE + 1];
+        /*the user's name, resolved once*/
+        int fd;
+        struct utmp* cache;
+        /*copy of the records from the last update*/
+        unsigned char* matches;
+        /*whether each cached record is a login of the user*/
+        size_t records;
+        /*number of cached records, the offset of the next appended record is
+        * records * sizeof(struct utmp)*/
+        size_t loggedIn;
+        /*number of cached records that are a login of the user*/
+        uint updates;
+        uint parsed;
+        int64_t totalNs;
+        int64_t maxNs;
+} Utmp_Watch;
+
+
+/***************************************************************************
+* int utmpWatchInit(Utmp_Watch* w)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that resolves the name of the user running the client
+*       and opens the utmp file
+*
+* Parameters:
+*        w              I/O     Utmp_Watch*     The utmp scanner
+*        utmpWatchInit  O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int utmpWatchInit(Utmp_Watch* w)
+{
+        memset(w, 0, sizeof(*w));
+
+        struct passwd* pwd = getpwuid(getuid());
+        /*the daemon has no terminal, so the name is looked up by UID rather
+        * than getlogin()*/
+        if(pwd == NULL)
+                return 0;
+        strncpy(w->user, pwd->pw_name, UT_NAMESIZE);
+
+        w->fd = open(_PATH_UTMP, O_RDONLY|O_CLOEXEC);
+        if(w->fd < 0)
+                return 0;
+
+        return 1;
+}
+
+/***************************************************************************
+* int utmpMatches(const Utmp_Watch* w, const struct utmp* rec)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that checks if a utmp record is a login of the user
+*
+* Parameters:
+*        w              I/P     const Utmp_Watch*       The utmp scanner
+*        rec            I/P     const struct utmp*      The record to check
+*        utmpMatches    O/P     int     Bool-type return value of whether the
+*                                       record is a login of the user
+**************************************************************************/
+int utmpMatches(const Utmp_Watch* w, const struct utmp* rec)
+{
+        return rec->ut_type == USER_PROCESS
+                && 0 == strncmp(rec->ut_user, w->user, UT_NAMESIZE);
+}
+
+/***************************************************************************
+* int utmpWatchUpdate(Utmp_Watch* w)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that brings the scanner up to date with the utmp file
+*       and returns whether the user is logged in. The file is read in a
+*       single call and compared against the copy from the last update; only
+*       records that were appended or changed since then are parsed. Records
+*       are rewritten in place when a login reuses an old slot, so changed
+*       records have to be found as well as appended ones.
+*
+* Parameters:
+*        w                 I/O  Utmp_Watch*     The utmp scanner
+*        utmpWatchUpdate   O/P  int             1 if the user is logged in, 0
+*                                               if not and -1 on failure
+**************************************************************************/
+int utmpWatchUpdate(Utmp_Watch* w)
+{
+        int64_t start = getMonotonicNs();
+        struct stat st;
+
+        if(fstat(w->fd, &st) < 0)
+                return -1;
+
+        size_t records = st.st_size / sizeof(struct utmp);
+        struct utmp* now = (struct utmp*) malloc((records ? records : 1)
+                                                * sizeof(struct utmp));
+        unsigned char* matches = (unsigned char*) calloc(records ? records : 1, 1);
+        if(now == NULL || matches == NULL){
+                free(now);
+                free(matches);
+                return -1;
+        }
+
+        ssize_t got = pread(w->fd, now, records * sizeof(struct utmp), 0);
+        if(got < 0){
+                free(now);
+                free(matches);
+                return -1;
+        }
+        records = got / sizeof(struct utmp);
+        /*the file may have shrunk since it was checked*/
+
+        size_t loggedIn = w->loggedIn;
+        for(size_t i = 0; i < records; i++){
+                if(i < w->records
+                        && 0 == memcmp(&now[i], &w->cache[i], sizeof(struct utmp))){
+                /*unchanged since the last update*/
+                        matches[i] = w->matches[i];
+                        continue;
+                }
+
+                if(i < w->records)
+                /*the record was rewritten, forget what it used to be*/
+                        loggedIn -= w->matches[i];
+                matches[i] = utmpMatches(w, &now[i]);
+                loggedIn += matches[i];
+                w->parsed++;
+        }
+        for(size_t i = records; i < w->records; i++)
+        /*records cut off the end of the file*/
+                loggedIn -= w->matches[i];
+
+        free(w->cache);
+        free(w->matches);
+        w->cache = now;
+        w->matches = matches;
+        w->records = records;
+        w->loggedIn = loggedIn;
+
+        int64_t took = getMonotonicNs() - start;
+        w->updates++;
+        w->totalNs += took;
+        if(took > w->maxNs)
+                w->maxNs = took;
+
+        return loggedIn > 0;
+}
+
+/***************************************************************************
+* void utmpWatchClose(Utmp_Watch* w)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes the utmp file, frees the scanner and
+*       reports how much time was spent scanning
+*
+* Parameters:
+*        w      I/O     Utmp_Watch*     The utmp scanner
+**************************************************************************/
+void utmpWatchClose(Utmp_Watch* w)
+{
+        LOGMSG(LOG_NOTICE,
+                "utmp: %u updates, %u records parsed, %lld us total, "
+                "%lld us max\n",
+                w->updates,
+                w->parsed,
+                (long long)(w->totalNs / 1000),
+                (long long)(w->maxNs / 1000)
+                );
+
+        if(w->fd >= 0)
+                close(w->fd);
+        free(w->cache);
+        free(w->matches);
+        w->cache = NULL;
+        w->matches = NULL;
+        w->fd = -1;
+}
+
+
+#endif // UTMP_H_INCLUDED
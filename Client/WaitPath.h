@@ -0,0 +1,249 @@
+/***************************************************************************
+* File:  WaitPath.h
+* Author:  SkibbleBip
+* Procedures:
+* getExistingAncestor   -Function that finds the deepest directory of a path
+*                               that currently exists
+* waitForPath           -Function that blocks using inotify until a path
+*                               exists, with an optional timeout
+* watchEntry            -Function that watches a path's directory for the
+*                               path being created, removed or replaced
+* entryChanged          -Function that reads the watch and tells whether the
+*                               path was among what changed
+***************************************************************************/
+
+#ifndef WAITPATH_H_INCLUDED
+#define WAITPATH_H_INCLUDED
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <poll.h>
+
+#include "../main.h"
+
+
+/***************************************************************************
+* int getExistingAncestor(const char* path, char* ancestor, size_t len)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that finds the deepest directory along a path that
+*       currently exists, ie for /run/user/1000/pulse/pid it returns
+*       /run/user/1000 if the pulse folder has not been created yet
+*
+* Parameters:
+*        path           I/P     const char*     The absolute path to check
+*        ancestor       I/O     char*           The deepest existing directory
+*        len            I/P     size_t          Size of the ancestor buffer
+*        getExistingAncestor    O/P     int     Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int getExistingAncestor(const char* path, char* ancestor, size_t len)
+{
+        struct stat st;
+
+        if(strlen(path) >= len || path[0] != '/'){
+                errno = EINVAL;
+                return 0;
+        }
+        strcpy(ancestor, path);
+
+        while(1){
+                char* slash = strrchr(ancestor, '/');
+                /*strip off the last component*/
+                if(slash == ancestor){
+                /*reached the root, which always exists*/
+                        ancestor[1] = '\000';
+                        return 1;
+                }
+                *slash = '\000';
+
+                if(stat(ancestor, &st) == 0){
+                        if(!S_ISDIR(st.st_mode)){
+                        /*something that isn't a directory is in the way, the
+                        * path can never be created*/
+                                errno = ENOTDIR;
+                                return 0;
+                        }
+                        return 1;
+                }
+        }
+}
+
+/***************************************************************************
+* int waitForPath(const char* path, int timeout)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Gives up on a signal to exit
+* Description: Function that blocks until a path exists without using any CPU
+*       while waiting. Only the deepest existing directory of the path is
+*       watched, and as each missing component is created the watch walks down
+*       to it. The path is checked again after every watch is added, so
+*       anything created in between is never missed. A signal to exit stops
+*       the wait, with errno EINTR.
+*
+* Parameters:
+*        path           I/P     const char*     The absolute path to wait for
+*        timeout        I/P     int             Milliseconds to wait for, or -1
+*                                               to wait forever
+*        waitForPath    O/P     int             Bool-type return value of
+*                                               whether the path exists. On a
+*                                               timeout errno is ETIMEDOUT
+**************************************************************************/
+int waitForPath(const char* path, int timeout)
+{
+        char dir[PATH_MAX];
+        const size_t buff_size = sizeof(struct inotify_event) + NAME_MAX + 1;
+        /*obtain the size of the inotify event*/
+        char event[buff_size];
+        int64_t deadline = getMonotonicNs() + (int64_t)timeout * 1000000LL;
+        int ret = 0;
+
+        if(access(path, F_OK) == 0)
+        /*if it already exists there is nothing to wait for*/
+                return 1;
+
+        int fd = inotify_init1(IN_CLOEXEC);
+        /*Initialize the Inotify instance*/
+        if(fd < 0)
+                return 0;
+
+        int wd = -1;
+        while(1){
+                if(!getExistingAncestor(path, dir, sizeof(dir)))
+                        break;
+
+                int newWd = inotify_add_watch(fd, dir,
+                        IN_CREATE|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF);
+                /*watch the deepest existing directory for its next component.
+                * Watching the same directory twice returns the same watch*/
+                if(newWd < 0){
+                        if(errno == ENOENT)
+                        /*the directory was removed before it was watched*/
+                                continue;
+                        break;
+                }
+                if(wd >= 0 && wd != newWd)
+                        inotify_rm_watch(fd, wd);
+                wd = newWd;
+
+                if(access(path, F_OK) == 0){
+                /*the path was created while the watch was being moved*/
+                        ret = 1;
+                        break;
+                }
+
+                char next[PATH_MAX];
+                if(getExistingAncestor(path, next, sizeof(next))
+                        && strcmp(next, dir) != 0){
+                /*a deeper directory appeared before the watch was added, walk
+                * down to it straight away*/
+                        continue;
+                }
+
+                int wait = -1;
+                if(timeout >= 0){
+                        int64_t left = deadline - getMonotonicNs();
+                        if(left <= 0){
+                                errno = ETIMEDOUT;
+                                break;
+                        }
+                        wait = (int)((left + 999999) / 1000000);
+                }
+
+                struct pollfd pfd[2] = {
+                        {fd, POLLIN, 0},
+                        {g_stopPipe[0], POLLIN, 0}
+                };
+                int p = poll(pfd, 2, wait);
+                /*sleep until something changes in the watched directory*/
+                if(p < 0 && errno != EINTR)
+                        break;
+                if(pfd[1].revents & POLLIN){
+                        errno = EINTR;
+                        break;
+                }
+                if((pfd[0].revents & POLLIN)
+                        && read(fd, event, buff_size) < 0 && errno != EINTR)
+                        break;
+                /*whatever happened, check the path again*/
+        }
+
+        close(fd);
+        /*close the inotify file descriptor, removing the watch with it*/
+
+        return ret;
+}
+
+/***************************************************************************
+* int watchEntry(const char* path)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that watches the directory holding a path for the
+*       path being created, removed, renamed over or having its attributes
+*       changed. The watch is non-blocking, poll it and read it with
+*       entryChanged.
+*
+* Parameters:
+*        path           I/P     const char*     The absolute path to watch
+*        watchEntry     O/P     int             The inotify descriptor, or -1
+**************************************************************************/
+int watchEntry(const char* path)
+{
+        char dir[PATH_MAX];
+
+        if(strlen(path) >= sizeof(dir) || path[0] != '/'){
+                errno = EINVAL;
+                return -1;
+        }
+        strcpy(dir, path);
+        char* slash = strrchr(dir, '/');
+        slash[slash == dir ? 1 : 0] = '\000';
+        /*the directory, keeping the root's slash*/
+
+        int fd = inotify_init1(IN_CLOEXEC|IN_NONBLOCK);
+        if(fd < 0)
+                return -1;
+        if(inotify_add_watch(fd, dir, IN_CREATE|IN_DELETE|IN_MOVED_TO
+                                |IN_MOVED_FROM|IN_ATTRIB) < 0){
+                close(fd);
+                return -1;
+        }
+        return fd;
+}
+
+/***************************************************************************
+* int entryChanged(int fd, const char* path)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads everything waiting on a watch from
+*       watchEntry, and tells whether any of it was about the path. It never
+*       blocks.
+*
+* Parameters:
+*        fd             I/P     int             The watch
+*        path           I/P     const char*     The path being watched
+*        entryChanged   O/P     int             Bool-type return value of
+*                                               whether the path changed
+**************************************************************************/
+int entryChanged(int fd, const char* path)
+{
+        char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)]
+                __attribute__((aligned(__alignof__(struct inotify_event))));
+        const char* name = strrchr(path, '/') + 1;
+        int changed = 0;
+        ssize_t size;
+
+        while((size = read(fd, buffer, sizeof(buffer))) > 0){
+                for(char* p = buffer; p < buffer + size;){
+                        struct inotify_event* e = (struct inotify_event*)p;
+                        if(e->len > 0 && strcmp(e->name, name) == 0)
+                                changed = 1;
+                        p += sizeof(struct inotify_event) + e->len;
+                }
+        }
+        return changed;
+}
+
+
+#endif // WAITPATH_H_INCLUDED
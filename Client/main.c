@@ -4,66 +4,120 @@
 * Procedures:
 * getPIDlocation        -Function that generates the location the PID file is
 *                               stored
-* shutdown              -Signal handler to process the shutdown procedures
+* shutdownDaemon        -Function that processes the shutdown procedures once
+*                               a signal to exit was caught
 * failedShutdown        -Function that concludes the shutdown procedures in the
 *                                event that an error were to occur
 * main                  -The main function
-* setup                 -Function that prepares the ALSA PCM handle and
-*                               properties for playback
-* playSound             -Plays sound in accordance to the inputted byte array,
-*                               data size, and PCM device as params
 * pollEvent             -Function that polls the pipe for new information on
 *                               the status of the keyboard dings
-* checkLoggedIn         -Function that polls the utmp file until the user has
-*                               logged in
+* pushClick             -Function that queues the click for a key press
+* connectToServer       -Function that blocks until the server can be
+*                               connected to
+* channelReplaced       -Function that checks whether the FIFO being read is
+*                               still the one at its path
+* resyncLockState       -Function that reads the current state of the lock
+*                               LEDs
+* blockUntilLoggedIn    -Function that blocks until the user has logged in
+* loadTask              -Startup task that loads the settings and decodes the
+*                               sounds
+* openAudio             -Function that opens the PCM device and converts the
+*                               sounds for it, run on the audio thread
+* lockSounds            -Function that faults in the converted sounds when
+*                               memory is locked
 * getUserDir            -Function that returns through a referenced parameter
 *                               the location of the User directory
 ***************************************************************************/
 
+#define _GNU_SOURCE
+/*for the CPU affinity calls in Realtime.h*/
+
 #include <alsa/asoundlib.h>
 #include <sys/stat.h>
 #include <sys/file.h>
 #include <pwd.h>
 #include <dirent.h>
-#include <utmp.h>
 #include <sys/inotify.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
 
 
-#include "CapsOn.h"
-#include "CapsOff.h"
 #include "../main.h"
-
-#define         PCM_DEVICE      "default"
-#define         RATE            44100
-#define         CHANNELS        1
-
-
-/*Struct to contain the properties of the ALSA API PCM handles*/
-typedef struct {
-        snd_pcm_t *pcm_Handle;
-        snd_pcm_hw_params_t *params;
-        snd_pcm_uframes_t frames;
-        uint periodTime;
-        uint buff_size;
-} Sound_Device;
+#include "Sound.h"
+#include "Playback.h"
+#include "Calibrate.h"
+#include "WaitPath.h"
+#include "Utmp.h"
+#include "Startup.h"
+#include "AudioThread.h"
+#include "../Realtime.h"
+#include "../Probes.h"
+#include "../Journal.h"
+#include "../Transport.h"
+
+#define         EVENT_BATCH     TRANSPORT_PACKET
+/*Most lock changes read from the pipe at once, a whole packet*/
+#define         RETRY_TIME      100
+/*Milliseconds to wait before connecting again to a socket that was just
+* created, in case the server has bound it but not listened on it yet*/
+#define         CLICK_MAX_AGE   150
+/*Default age in milliseconds after which a key press is too old to click for
+* (DINGER_CLICK_MAX_AGE_MS)*/
+#define         STALE_CLICK_LOG 100
+/*Log only every this many stale clicks, a held key on a stalled client
+* would make one per repeat*/
+#define         LOAD_STACK      (256 * 1024)
+/*Stack size of the load task, kept small so it fits in RLIMIT_MEMLOCK when
+* memory is locked*/
+
+/*States of the connection between the client and server*/
+typedef enum {  CLIENT_WAITING,
+                CLIENT_CONNECTING,
+                CLIENT_CONNECTED
+        } Client_State_t;
 
 
 /*Global variables to handles and parameters*/
 int g_pidfile;
-volatile int g_pipeLocation;
-snd_pcm_t *g_pcmHandle;
+Channel g_channel = {NULL, NULL, -1, -1, -1, -1, NULL, (gid_t)-1};
+/*the link to the server*/
+int g_pathWatch = -1;
+/*inotify watch on the directory of the server's FIFO or socket*/
+int g_lockState[TOGGLE_AXIS] = {-1, -1, -1};
+/*last known state of each lock, -1 if unknown*/
+pthread_t g_loadThread;
+int g_haveStoredLatency;
+/*whether the load task found a calibrated latency for the device*/
+int64_t g_maxAgeNs;
+/*lock changes older than this are not dinged for, 0 to ding for all*/
+uint g_staleDrops;
+/*how many lock changes were too old to ding for*/
+uint g_received;
+uint g_folded;
+/*how many lock changes were read, and how many of them cancelled out within
+* a batch*/
+int64_t g_clickMaxAgeNs;
+/*key presses older than this are not clicked for, 0 to click for all*/
+uint g_clicks;
+uint g_staleClicks;
+/*how many key presses were read in typewriter mode, and how many were too
+* old to click for*/
 
 /*Definitions of functions*/
-int setup(Sound_Device *dev);
-void playSound(const unsigned char* sound, const long int size, Sound_Device *dev);
-void pollEvent(Sound_Device *dev/*, bool *stuck*/);
-int checkLoggedIn(void);
+int pollEvent(void);
+void pushClick(const Lock_Message* m);
+void connectToServer(void);
+int channelReplaced(void);
+void resyncLockState(void);
 void getUserDir(char* location);
 void getPIDlocation(char* in);
-void shutdown(int sig);
+void shutdownDaemon(int sig);
 void failedShutdown(void);
 int blockUntilLoggedIn(void);
-int blockForPA_PID(char* pidLocation);
+void* loadTask(void* arg);
+void openAudio(Sound_Device *dev);
+void lockSounds(void);
 
 int main(void);
 
@@ -71,7 +125,9 @@ int main(void);
 /***************************************************************************
 * int main(void)
 * Author: SkibbleBip
-* Date: 05/23/2021
+* Date: 05/23/2021      v1: Initial
+* Date: 10/19/2026      v2: Independent startup steps run in parallel
+* Date: 10/19/2026      v3: Memory locked before any thread starts
 * Description: The main function
 *
 * Parameters:
@@ -87,7 +143,7 @@ int main(void)
                 getUserDir(userDir);
                 /*obtain the runtime directory*/
 
-                syslog(LOG_NOTICE,
+                LOGMSG(LOG_NOTICE,
                 "XDG_RUNTIME_DIR was not defined, defining it ourselves..."
                 );
 
@@ -95,7 +151,7 @@ int main(void)
                 /*if it's not defined, define it ourself. If it STILL wont
                 *define, display an error and exit
                 */
-                        syslog(LOG_ERR, "Failed to set runtime directory: %m");
+                        LOGMSG(LOG_ERR, "Failed to set runtime directory: %m");
                         exit(-1);
                 }
         }
@@ -104,57 +160,43 @@ int main(void)
 
         Sound_Device device;
         /*Struct of ALSA properties*/
+        memset(&device, 0, sizeof(device));
+        selectOutput(&device);
+        /*which output the sounds are played to*/
         char pid_location[50];
         /*Buffer to hold the location of the PID file*/
 
-        pid_t pid = fork();
-        /*Fork for the first time*/
-
-        /*close the parent*/
-        if(pid < 0){
-                syslog(LOG_ERR, "Failed to fork: %m");
-                exit(-1);
-        }if(pid>0){
-                syslog(LOG_NOTICE, "Successfully forked daemon\n");
-                exit(0);
-        }if(setsid() <0){
-                syslog(LOG_ERR, "Failed to setsid: %m");
-                exit(-1);
-        }
-        pid = fork();
-        /*Fork second time*/
-        if(pid < 0){
-                syslog(LOG_ERR, "Failed to fork: %m");
-                exit(-1);
-        }if(pid>0){
-                syslog(LOG_NOTICE, "Successfully forked second time\n");
-                exit(0);
-        }
-
-
-        if(chdir("/") < 0){
-        /*Change the directory to root*/
-                syslog(LOG_ERR, "Failed to change to root: %m");
+        markPhase("started");
+        if(daemonise(-1) == 0){
+        /*Detach into a daemon*/
                 failedShutdown();
         }
-        umask(0);
-        close(STDIN_FILENO);
-        close(STDOUT_FILENO);
-        close(STDERR_FILENO);
-        /*close the IO handles*/
-
-        for(int i= sysconf(_SC_OPEN_MAX); i>=0; i--){
-        /*close any open handles*/
-                close(i);
+        lockMemory(NULL, 0);
+        /*Opt-in memory locking, done before any thread is started so their
+        * stacks are the only mappings added to what RLIMIT_MEMLOCK covers*/
+        logStart();
+        /*From here on logging never blocks, it is written out by a thread*/
+        markPhase("daemonised");
+
+        pthread_attr_t loadAttr;
+        pthread_attr_init(&loadAttr);
+        pthread_attr_setstacksize(&loadAttr, LOAD_STACK);
+        if(pthread_create(&g_loadThread, &loadAttr, loadTask, &device) != 0){
+        /*Load the settings and decode the sounds while waiting for the user
+        * to log in*/
+                LOGMSG(LOG_ERR, "Failed to start load task: %m");
+                failedShutdown();
         }
+        pthread_attr_destroy(&loadAttr);
 
 
         if(0 == blockUntilLoggedIn()){
         /*block until user has logged in*/
-                syslog(LOG_ERR, "Failed to wait for login: %m");
+                LOGMSG(LOG_ERR, "Failed to wait for login: %m");
                 failedShutdown();
 
         }
+        markPhase("logged in");
 
 
 
@@ -167,7 +209,7 @@ int main(void)
         *PID location in the tmp folder.
         */
                 memcpy(pid_location, "/tmp/CapsLockClient.pid", 24);
-                syslog(LOG_ALERT,
+                LOGMSG(LOG_ALERT,
                 "Could not write PID to default location, defaulting to %s\n",
                 pid_location
                         );
@@ -180,7 +222,7 @@ int main(void)
         /*if the PID file is failed to be created, then the daemon is already
         * running
         */
-                syslog(LOG_ERR, "Failure to create PID file\n");
+                LOGMSG(LOG_ERR, "Failure to create PID file\n");
                 failedShutdown();
         }
         else{
@@ -188,75 +230,88 @@ int main(void)
                 snprintf(toWrite, 20, "%d", getpid());
                 if(0 > write(g_pidfile, toWrite, strlen(toWrite))){
                 /*Write PID to PID file*/
-                        syslog(LOG_ERR, "Failed to write to PID file: %m");
+                        LOGMSG(LOG_ERR, "Failed to write to PID file: %m");
                         failedShutdown();
                 }
 
         }
+        markPhase("PID locked");
+
+        g_maxAgeNs = (int64_t)getConfigUInt("DINGER_MAX_AGE_MS", MAX_EVENT_AGE)
+                        * 1000000;
+        g_clickMaxAgeNs = (int64_t)getConfigUInt("DINGER_CLICK_MAX_AGE_MS",
+                                                CLICK_MAX_AGE) * 1000000;
+
+        applyRealtime();
+        /*Opt-in real-time scheduling and CPU pinning. The audio thread
+        * started next inherits it, the load task does not*/
+
+        if(getConfigUInt("DINGER_JOURNAL", 1)){
+        /*record every lock change in the flight recorder*/
+                char journal[150];
+                getUserDir(journal);
+                strncat(journal, "/CapsLockClient.journal",
+                        sizeof(journal) - strlen(journal) - 1);
+                journalOpen(&g_journal, journal, "client");
+        }
 
-        char pulse_pid[100];
-        getUserDir(pulse_pid);
-        /*obtain the location of the pulseaudio pid file*/
-
-        memcpy(pulse_pid+strlen(pulse_pid), "/pulse/pid", 11);
-        /*Complete the path of the PID file*/
-
-        //if(blockForPA_PID(pulse_pid) == 0){
-        /*wait for the creation of the PulseAudio PID file*/
-        //        syslog(LOG_ERR, "Failed waiting for PulseAudio PID: %m");
-        //        failedShutdown();
-        //}
-
-
-        while(open(pulse_pid, O_EXCL) == -1)
-                ;
-        /**A HACK: this polls until the pulseaudio pid exists. This could
-        * be done better using blocking inotify's, but due to race conditions
-        * and overcomplicating things it might be easier to wait until the pid
-        * file exists. It doesn't take long anyway for pulseaudio to start
-        **/
-
-        if(setup(&device) == 0){
-        /*Set up the sound PCM device*/
-                syslog(LOG_ERR, "Failed to set up sound devices: %m");
+        if(!startAudioThread(&g_audio, &device, openAudio,
+                                getConfigUInt("DINGER_LAZY_PCM", 0))){
+        /*Start the thread that owns the sound device. It opens the device
+        * while waiting for the server, or in lazy mode when the first event
+        * arrives*/
+                LOGMSG(LOG_ERR, "Failed to start audio thread: %m");
                 failedShutdown();
         }
+
+        if(!catchStopSignals()){
         /*Signal for closing application*/
-        signal(SIGQUIT, shutdown);
-        signal(SIGTERM, shutdown);
+                LOGMSG(LOG_ERR, "Failed to catch signals: %m");
+                failedShutdown();
+        }
 
 
-        syslog(LOG_NOTICE,
+        LOGMSG(LOG_NOTICE,
                 "Opening Caps Lock detection client for %s\n",
                 getlogin()
                 );
 
 
-        ///TODO: blocking waiting and not polling waiting for caps FIFO
-        while(open(CAPS_FILE_DESC, O_EXCL) == -1)
-                ;
-        /*while the FIFO file does not exist, continue waiting*/
-
-
-        g_pipeLocation = open(CAPS_FILE_DESC, O_RDONLY);
-
-
-        /*Open the FIFO*/
-        if(g_pipeLocation == -1){
-        /*If invalid FIFO, then display error*/
-                syslog(LOG_ERR, "Failed to open Caps File FIFO: %m");
-                failedShutdown();
-        }
-
-        uid_t uid = getuid();
-        /*Get the UID of the client's */
-        struct passwd *pwd = getpwuid(uid);
-        syslog(LOG_NOTICE, "Client connected to server for %s\n", pwd->pw_name);
+        Client_State_t state = CLIENT_WAITING;
+        /*The sound device and sounds stay loaded while the server is away, so
+        * only the connection has to be made again*/
 
         while(1){
         /*loop until told to stop*/
-                pollEvent(&device/*, &isStuck*/);
-                snd_pcm_prepare(device.pcm_Handle);
+                if(g_stopSignal)
+                        shutdownDaemon(g_stopSignal);
+
+                switch(state){
+                case CLIENT_WAITING:
+                        connectToServer();
+                        state = CLIENT_CONNECTING;
+                        break;
+
+                case CLIENT_CONNECTING:{
+                        markPhase("server connected");
+                        resyncLockState();
+                        /*the locks may have changed while disconnected*/
+                        struct passwd *pwd = getpwuid(getuid());
+                        LOGMSG(LOG_NOTICE, "Client connected to server for %s\n",
+                                pwd != NULL ? pwd->pw_name : "?");
+                        state = CLIENT_CONNECTED;
+                        break;
+                }
+
+                case CLIENT_CONNECTED:
+                        if(pollEvent() == 0){
+                        /*the server went away, close our end and go idle
+                        * until it returns*/
+                                transportClose(&g_channel);
+                                state = CLIENT_WAITING;
+                        }
+                        break;
+                }
         }
 
 
@@ -266,451 +321,541 @@ int main(void)
         return 0;
 }
 /***************************************************************************
-* int setup(Sound_Device *dev)
-* Author: Skibblebip
-* Date: 05/20/2021
-* Description: Function that prepares the ALSA PCM handle and properties for
-*              playback
+* int pollEvent(void)
+* Author: SkibbleBip
+* Date: 06/03/2021      v1: Initial
+* Date: 10/19/2026      v2: Returns 0 when the server goes offline instead of
+*                               shutting down
+* Date: 10/19/2026      v3: Queues the sound for the audio thread instead of
+*                               playing it
+* Date: 10/19/2026      v4: Lock changes that are too old are not dinged for
+* Date: 10/19/2026      v5: Reads everything waiting in the pipe and only
+*                               dings for the net change of each lock
+* Date: 10/19/2026      v6: Reads through whichever transport the server
+*                               uses
+* Date: 10/19/2026      v7: Clicks for key presses in typewriter mode
+* Date: 10/19/2026      v8: Notices the FIFO being replaced by a restarted
+*                               server
+* Date: 10/19/2026      v9: Wakes up for a signal to exit
+* Date: 10/19/2026      v10: No longer takes the unused sound device
+* Description: Function that waits for lock changes on the pipe, then reads
+*               every change that is waiting. The batch is folded down to the
+*               final state of each lock, so a burst of presses gives at most
+*               one ding per lock instead of one per press. Key presses are
+*               not folded, each one is queued as a click straight away
+*               unless it is too old to still sound like part of the typing.
 *
 * Parameters:
-*        dev    I/O     Sound_Device*   The struct containing ALSA PCM handle
-*                                       and properties
-*        setup  O/P     int             Bool-type return value of whether there
-*                                       was a failure
+*        pollEvent      O/P     int             Bool-type return value of
+*                                               whether the server is still
+*                                               connected
 **************************************************************************/
-int setup(Sound_Device *dev){
-        uint rate = RATE;
-        /*obtain the temporary value of the rate*/
-        if(snd_pcm_open(
-        /*open the default playback device and return it to the pcm handle*/
-                &(dev->pcm_Handle),
-                PCM_DEVICE,
-                SND_PCM_STREAM_PLAYBACK,
-                0
-                ) < 0)
+int pollEvent(void){
+        Lock_Message received[EVENT_BATCH];
+        /*The lock changes received from the pipe*/
+        Lock_Message last[TOGGLE_AXIS];
+        int seen[TOGGLE_AXIS] = {0, 0, 0};
+        /*The final change of each lock in the batch*/
+        Journal_Entry* lastEntry[TOGGLE_AXIS];
+        uint64_t lastPos[TOGGLE_AXIS];
+        /*and its journal entry*/
+        uint count = 0;
+        /*How many changes the batch held*/
+        int connected = 1;
+        struct pollfd pfd[3] = {
+                {g_channel.fd, POLLIN, 0},
+                {g_stopPipe[0], POLLIN, 0},
+                {g_pathWatch, POLLIN, 0}
+        };
+        int fifo = g_channel.t->kind == TRANSPORT_FIFO;
+
+        if(poll(pfd, fifo ? 3 : 2, -1) < 0){
+        /*block until the server writes something or goes away, or a signal
+        * to exit is caught. A FIFO left behind by a killed server never hangs
+        * up, so the path is watched for the next server replacing it as
+        * well*/
+                if(errno == EINTR)
+                        return 1;
+                LOGMSG(LOG_ERR, "Failed to poll the Caps Lock Pipe: %m");
+                failedShutdown();
+        }
+        if(pfd[1].revents & POLLIN)
+        /*the main loop shuts down*/
+                return 1;
+        if(fifo && (pfd[2].revents & POLLIN)
+                && entryChanged(g_pathWatch, CAPS_FILE_DESC)
+                && channelReplaced()){
+                LOGMSG(LOG_ERR, "Server Daemon has replaced the FIFO\n");
                 return 0;
+        }
+        if(pfd[0].revents == 0)
+                return 1;
 
-        snd_pcm_hw_params_alloca(&(dev->params));
-        snd_pcm_hw_params_any(dev->pcm_Handle, dev->params);
-        /*Allocate parameters and apply them to the pcm device*/
-        if(snd_pcm_hw_params_set_access(
-        /*Set access mode for the PCM device*/
-                dev->pcm_Handle,
-                dev->params,
-                SND_PCM_ACCESS_RW_INTERLEAVED
-                ) < 0)
-		return 0;
-
-	if(snd_pcm_hw_params_set_format(
-	/*set format of the playback*/
-                dev->pcm_Handle,
-                dev->params,
-                SND_PCM_FORMAT_S16_LE
-                ) < 0)
-		return 0;
-
-	if(snd_pcm_hw_params_set_channels(
-	/*Set the channel number of the playback*/
-                dev->pcm_Handle,
-                dev->params,
-                CHANNELS
-                ) < 0)
-		return 0;
-
-	if(snd_pcm_hw_params_set_rate_near(
-	/*Set the rate of the playback*/
-                dev->pcm_Handle,
-                dev->params,
-                &rate,
-                0
-                ) < 0)
-		return 0;
-
-
-	if(snd_pcm_hw_params(dev->pcm_Handle, dev->params) < 0)
-	/*Write parameters*/
-		return 0;
-
-
-        /*Allocate the buffer to hold a single period time length*/
-	snd_pcm_hw_params_get_period_size(dev->params, &(dev->frames), 0);
-
-	dev->buff_size = dev->frames * CHANNELS *2;
-	/*define the buffer size in accordance to the frames and channels size*/
-
-	g_pcmHandle = dev->pcm_Handle;
-	/*set a global pointer to the PCM handle, this will be cleared */
-
-
-        return 1;
-}
+        while(1){
+        /*the channel is non-blocking, so read until it is empty*/
+                ssize_t size = g_channel.t->receive(&g_channel, received,
+                                                        EVENT_BATCH);
+                if(size == 0){
+                /*If 0 bytes were read, then the server is no longer writing
+                * to the pipe, so wait for it to come back once the batch is
+                * played
+                */
+                        LOGMSG(LOG_ERR, "Server Daemon has gone offline\n");
+                        connected = 0;
+                        break;
+                }
+                else if(size < 0){
+                        if(errno == EAGAIN || errno == EINTR)
+                        /*the pipe is empty*/
+                                break;
+                        /*If the pipe was not able to be read, then a failure
+                        * has occured, close out of the daemon
+                        */
+                        LOGMSG(LOG_ERR, "Failed to read the Caps Lock Pipe: %m");
+                        failedShutdown();
+                }
 
-/***************************************************************************
-* void playSound(const unsigned char* sound, const long int size,Sound_Device *dev)
-* Author: SkibbleBip
-* Date: 06/01/2021
-* Description: Plays sound in accordance to the inputted byte array, data size,
-*       and PCM device as params
-*
-* Parameters:
-*        sound  I/P     const unsigned char*    Sound data char array
-*        size   I/P     const long int          Size of the data array
-*        dev    I/O     Sound_Device*           Struct containing the ALSA PCM
-*                                               handle and properties
-**************************************************************************/
-void playSound(const unsigned char* sound, const long int size,Sound_Device *dev){
-        wavByte_t* buffer = (wavByte_t*) malloc(dev->buff_size);
-	long int c = 0;
-	uint bSize = dev->buff_size;
-	uint frms = dev->frames;
-	/*frame and buffer size must change as near the end of the audio stream
-	*the remaining WAV data will be too small to fit in the buffer, so the
-	*frame size and buffer size will be changed so the remaining audio isnt
-	*disorted
-	*/
-	while(size > c){
-                if((size-c) < bSize){
-                /*If the remaining buffer size is smaller than the default,
-                * then change the frame size and buffer size*/
-                        bSize = size - c;
-                        frms = bSize / (CHANNELS * 2);
+                for(ssize_t i = 0; i < size; i++){
+                        PROBE3(receive, received[i].seq, received[i].kernelNs,
+                                getBoottimeNs());
+                        if(received[i].status >= CLICK_KEY){
+                                pushClick(&received[i]);
+                                continue;
+                        }
+                        int lock = received[i].status % TOGGLE_AXIS;
+                        if(seen[lock] && lastEntry[lock] != NULL)
+                        /*this change replaces the one before it*/
+                                lastEntry[lock]->outcome = OUTCOME_COALESCED;
+
+                        Journal_Entry* e = journalNext(&g_journal, &lastPos[lock]);
+                        if(e != NULL){
+                                e->seq = received[i].seq;
+                                e->status = received[i].status;
+                                e->kernelNs = received[i].kernelNs;
+                                e->receiveNs = getBoottimeNs();
+                                e->outcome = OUTCOME_RECEIVED;
+                        }
+                        lastEntry[lock] = e;
+                        last[lock] = received[i];
+                        seen[lock] = 1;
+                        count++;
                 }
-                memcpy(buffer, sound+c, bSize);
-                /*copy the sound data into the buffer*/
-                snd_pcm_writei(dev->pcm_Handle, buffer, frms);
-                c+=bSize;
-                ///TODO: Make this look less like crap
+        }
 
-	}
+        uint played = 0;
+        for(int lock = 0; lock < TOGGLE_AXIS; lock++){
+                if(!seen[lock])
+                        continue;
+
+                int on = last[lock].status < TOGGLE_AXIS;
+                /*which way the lock ended up*/
+                Journal_Entry* e = lastEntry[lock];
+
+                if(g_lockState[lock] == on){
+                /*the lock is already in this state, so there is nothing to
+                * ding about*/
+                        if(e != NULL)
+                                e->outcome = OUTCOME_UNCHANGED;
+                        continue;
+                }
+                g_lockState[lock] = on;
+
+                int64_t age = getBoottimeNs() - last[lock].kernelNs;
+                if(g_maxAgeNs > 0 && age > g_maxAgeNs){
+                /*the change happened too long ago (ie before a suspend, or
+                * while the client was stalled) for the user to connect a ding
+                * to it, so only keep the new state*/
+                        g_staleDrops++;
+                        if(e != NULL)
+                                e->outcome = OUTCOME_STALE;
+                        LOGMSG(LOG_NOTICE,
+                                "Not dinging for event %u, %lld ms old "
+                                "(%u stale so far)\n",
+                                last[lock].seq, (long long)(age / 1000000),
+                                g_staleDrops);
+                        continue;
+                }
 
-        free(buffer);
-        //free the dynamic buffer
+                played++;
+                if(e != NULL)
+                /*set before the push, the audio thread may play it at once*/
+                        e->outcome = OUTCOME_QUEUED;
+                if(!queuePush(&g_audio.queue, last[lock].status, last[lock].seq,
+                                lastPos[lock])){
+                /*hand the sound to the audio thread, so a slow device never
+                * holds up reading the pipe*/
+                        if(e != NULL)
+                                e->outcome = OUTCOME_DROPPED;
+                        LOGMSG(LOG_ALERT, "Audio queue is full, dropping event\n");
+                }
+        }
 
+        g_received += count;
+        if(count > 1){
+        /*report how much of the burst was folded away*/
+                g_folded += count - played;
+                LOGMSG(LOG_NOTICE,
+                        "Folded %u lock changes into %u dings "
+                        "(%u of %u folded so far)\n",
+                        count, played, g_folded, g_received);
+        }
 
+        return connected;
 
 }
+
 /***************************************************************************
-* void pollEvent(Sound_Device *dev)
+* void pushClick(const Lock_Message* m)
 * Author: SkibbleBip
-* Date: 06/03/2021
-* Description: Function that polls the pipe for new information on the status
-*               of the keyboard dings
+* Date: 10/19/2026
+* Description: Function that queues the click for a key press. Clicks are
+*       not folded or journaled, every key press gets its own, unless it is
+*       older than g_clickMaxAgeNs. A click that late would come out after
+*       the typing it belongs to.
 *
 * Parameters:
-*        dev    I/O     Sound_Device*   The struct of ALSA PCM handle and
-*                                       properties
+*        m      I/P     const Lock_Message*     The key press
 **************************************************************************/
-void pollEvent(Sound_Device *dev/*, bool *stuck*/){
-        //unsigned char received;
-        Status_t received;
-        /*The byte of the received data from the pipe*/
-        int size;
-        /*The length of bytes read*/
-
-
-        size = read(g_pipeLocation, &received, sizeof(Status_t));
-        ///TODO: Make it so the client daemon can continue running idle when
-        ///the server daemon or pipe goes offline, and can start back up when
-        ///the server goes back online
-        /*if(size == 0){
-                if(*stuck == false){
-                        *stuck = true;
-                        syslog(LOG_ERR, "Pipe is disconnected!\n");
-                }
-                printf("one\n");
-                close(g_pipeLocation);
-                //g_pipeLocation = -1;
-                do{
-                        g_pipeLocation = open(CAPS_FILE_DESC, O_RDONLY);
-                        //Crack cocaine hack that detects when the server goes
-                        //offline
-                }while(g_pipeLocation <0);
-        }*/
-        if(size == 0){
-        /*If 0 bytes were read, then the server is no longer writing to the
-        * pipe, so close out of the client daemon
-        */
-                syslog(LOG_ERR, "Server Daemon has gone offline\n");
-                failedShutdown();
+void pushClick(const Lock_Message* m)
+{
+        if(m->status >= CLICK_KEY + CLICK_CLASSES)
+        /*from a newer server, nothing to play for it*/
+                return;
+        g_clicks++;
+
+        int64_t age = getBoottimeNs() - m->kernelNs;
+        if(g_clickMaxAgeNs > 0 && age > g_clickMaxAgeNs){
+                if(g_staleClicks++ % STALE_CLICK_LOG == 0)
+                        LOGMSG(LOG_NOTICE,
+                                "Not clicking for event %u, %lld ms old "
+                                "(%u of %u clicks stale so far)\n",
+                                m->seq, (long long)(age / 1000000),
+                                g_staleClicks, g_clicks);
+                return;
         }
-        else if(size < 0){
-        /*If the pipe was not able to be read, then a failure has occured,
-        * close out of the daemon
-        */
-                syslog(LOG_ERR, "Failed to read the Caps Lock Pipe: %m");
-                failedShutdown();
 
-        }
-        else{
-                //*stuck = false;
+        if(!queuePush(&g_audio.queue, m->status, m->seq, 0))
+                LOGMSG(LOG_ALERT, "Audio queue is full, dropping click\n");
+}
 
-                if(received < TOGGLE_AXIS){
-                /*If the received data is a caps on enum, then play the rising
-                * ding
-                */
-                        playSound(Caps_On_wav, Caps_On_wav_size, dev);
+/***************************************************************************
+* void connectToServer(void)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Connects over whichever transport the server
+*                               uses
+* Date: 10/19/2026      v3: Does not wait on the FIFO for a writer
+* Date: 10/19/2026      v4: Waits for a socket left behind to be replaced
+*                               instead of retrying it
+* Date: 10/19/2026      v5: Returns on a signal to exit
+* Description: Function that blocks until the server's FIFO or socket exists
+*       and the server is there, then connects to it through g_channel.
+*       No wait uses any CPU. A socket nobody listens on is tried once more
+*       after RETRY_TIME, as the server may be between binding and
+*       listening, and after that only when g_pathWatch sees the path change.
+*       The FIFO is opened at once, even one left behind by a killed server;
+*       pollEvent notices through g_pathWatch when the next server replaces
+*       it. Once a signal to exit is caught it returns without connecting,
+*       for the main loop to shut down.
+*
+* Parameters: N/A
+**************************************************************************/
+void connectToServer(void)
+{
+        int fresh = 1;
+        /*whether the path may have been created just now*/
 
+        if(g_pathWatch < 0 && (g_pathWatch = watchEntry(CAPS_FILE_DESC)) < 0)
+                LOGMSG(LOG_ALERT, "Failed to watch Caps File FIFO: %m");
+        while(1){
+                if(g_stopSignal)
+                /*the main loop shuts down*/
+                        return;
+                if(waitForPath(CAPS_FILE_DESC, -1) == 0){
+                /*block until the server has created the FIFO or socket*/
+                        if(errno == EINTR)
+                                continue;
+                        LOGMSG(LOG_ERR, "Failed waiting for Caps File FIFO: %m");
+                        failedShutdown();
                 }
-                else /*if(received == CAPS_OFF)*/{
-                /*If the received data is a caps off enum, then play the
-                * falling dong
-                */
-                        playSound(Caps_Off_wav, Caps_Off_wav_size, dev);
 
+                if(g_pathWatch >= 0)
+                /*forget the changes from before this attempt*/
+                        entryChanged(g_pathWatch, CAPS_FILE_DESC);
+                if(transportConnect(&g_channel, CAPS_FILE_DESC)){
+                /*Open the FIFO or connect to the socket, which blocks until
+                * the server is there. From here on the channel is waited on
+                * with poll, so a backlog can be read without blocking*/
+                        LOGMSG(LOG_NOTICE, "Connected over %s\n",
+                                g_channel.t->name);
+                        return;
                 }
-                snd_pcm_drain(dev->pcm_Handle);
-                /*Drain the pcm handle*/
 
+                if(errno == ECONNREFUSED || errno == ECONNRESET){
+                /*the socket is left over, or the server went away while
+                * greeting us. Sleep until the next server replaces it*/
+                        struct pollfd pfd[2] = {
+                                {g_pathWatch, POLLIN, 0},
+                                {g_stopPipe[0], POLLIN, 0}
+                        };
+                        if(poll(pfd, 2, fresh || g_pathWatch < 0
+                                        ? RETRY_TIME : -1) < 0
+                                && errno != EINTR){
+                                LOGMSG(LOG_ERR, "Failed waiting for Caps "
+                                        "File socket: %m");
+                                failedShutdown();
+                        }
+                        fresh = (pfd[0].revents & POLLIN)
+                                && entryChanged(g_pathWatch, CAPS_FILE_DESC);
+                        continue;
+                }
+                if(errno != ENOENT && errno != EINTR){
+                /*If invalid FIFO, then display error*/
+                        LOGMSG(LOG_ERR, "Failed to open Caps File FIFO: %m");
+                        failedShutdown();
+                }
+                /*the FIFO was removed again before it was opened, wait for
+                * the next one*/
         }
-
-
-
 }
 
 /***************************************************************************
-* int checkLoggedIn(void)
-* Author: Skibblebip
-* Date: 06/09/2021
-* Description: Checks if the user running the client has logged into a TTY or
-*               other terminal
+* int channelReplaced(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that checks whether the FIFO being read is still the
+*       one at CAPS_FILE_DESC. A server that starts removes the old one and
+*       makes a new one, and nothing will ever write to the old one again.
 *
 * Parameters:
-*        checkLoggedIn  O/P     int     Boolean int that determines if user was
-*                                               logged in or not yet
+*        channelReplaced        O/P     int     Bool-type return value of
+*                                               whether it was removed or
+*                                               replaced
 **************************************************************************/
-int checkLoggedIn(void){
-//utmp location: /run/utmp
-
-        struct utmp *tmp;
-        setutent();
-        /*set the utmp file pointer to the front*/
-
-        tmp = getutent();
-        /*obtain the first utmp struct*/
-
-        while(tmp != NULL){
-        /*while the end of the utmp has not been reached, check each obtained
-        * struct if they are a user_process
-        */
-                if(tmp->ut_type == USER_PROCESS){
-                        if(0 == strcmp(tmp->ut_user, getlogin())){
-                        /*if the username of the process is the same as the
-                        *client's log-in name, then we know the user has logged
-                        *in fully.
-                        */
-                                return 1;
-                        }
-                }
-                tmp = getutent();
-                /*get next utmp struct*/
+int channelReplaced(void)
+{
+        struct stat current;
+        struct stat opened;
 
-        }
+        if(fstat(g_channel.fd, &opened) < 0 || stat(CAPS_FILE_DESC, &current) < 0)
+                return 1;
+        return current.st_ino != opened.st_ino || current.st_dev != opened.st_dev;
+}
 
-        return 0;
-        /*The user was found to be not logged in yet*/
+/***************************************************************************
+* void resyncLockState(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads the current state of the lock LEDs so that
+*       changes made while the server was away are not dinged for late
+*
+* Parameters: N/A
+**************************************************************************/
+void resyncLockState(void)
+{
+        for(int i = 0; i < TOGGLE_AXIS; i++)
+                g_lockState[i] = readLedState(i);
 }
+
 /***************************************************************************
 * int blockUntilLoggedIn(void)
 * Author: SkibbleBip
-* Date: 06/13/2021
+* Date: 06/13/2021      v1: Initial
+* Date: 10/19/2026      v2: Only parses the utmp records that changed
 * Description: Uses inotify syscall to block until the user has logged in.
 *
 * Parameters: N/A
 **************************************************************************/
 int blockUntilLoggedIn(void)
 {
-
-        if(checkLoggedIn())
-        /*if user is already logged in, then return true*/
-                return 1;
-
-
+        Utmp_Watch utmp;
+        /*the incremental utmp scanner*/
         const size_t buff_size = sizeof(struct inotify_event) + NAME_MAX + 1;
         /*obtain the size of the inotify event*/
-        struct inotify_event* event = (struct inotify_event*)malloc(buff_size);
-        /*dynamically allocate the inotify event*/
-        int fd, wd;
-        /*file decriptors of the initializer and watchdogs*/
-        fd = inotify_init();
-        /*Initialize the Inotify instance*/
+        char event[buff_size];
+        int ret = 0;
 
-        if(fd < 0){
-        /*if failed to initialize, return false*/
+        if(!utmpWatchInit(&utmp))
                 return 0;
-        }
 
-        wd = inotify_add_watch(fd, "/run/utmp", IN_MODIFY);
-        /*add a watchdog for when the utmp file is modified*/
+        int fd = inotify_init1(IN_CLOEXEC);
+        /*Initialize the Inotify instance*/
 
-        if(wd < 0)
-        /*if it failed to add the watch, return false*/
+        if(fd < 0 || inotify_add_watch(fd, _PATH_UTMP, IN_MODIFY) < 0){
+        /*if failed to initialize or to add a watchdog for when the utmp file
+        * is modified, return false. The watch is added before the first
+        * check so no login in between is missed*/
+                if(fd >= 0)
+                        close(fd);
+                utmpWatchClose(&utmp);
                 return 0;
+        }
 
-        u_char triggered = 0;
-        /*flag for if it detected the logged in user*/
-
-        do{
-                int ret = read(fd, event, buff_size);
-                /*block until an inotify event is read*/
-                if(ret < 0)
-                        return 0;
-
-                if(checkLoggedIn() == 1){
-                /*check if the user was logged in during the event. if they did,
-                * set the flag to true
-                */
-                        triggered = 1;
-                        //free(event);
-                }
-
-        }while(triggered == 0);
+        while((ret = utmpWatchUpdate(&utmp)) == 0){
         /*continue looping until the user has been verified that they are
         * logged in
         */
+                if(read(fd, event, buff_size) < 0 && errno != EINTR){
+                /*block until an inotify event is read*/
+                        ret = -1;
+                        break;
+                }
+        }
 
-
-        free(event);
-        /*free the event buffer*/
-        inotify_rm_watch(fd, wd);
-        /*remove the watchdog*/
         close(fd);
-        /*close the inotify file descriptor*/
+        /*close the inotify file descriptor, removing the watchdog with it*/
+        utmpWatchClose(&utmp);
 
-        return 1;
+        return ret == 1;
 }
 /***************************************************************************
-* int blockForPA_PID(char* pidLocation)
+* void* loadTask(void* arg)
 * Author: SkibbleBip
-* Date: 06/13/2021
-* Description: Function that blocks until the PulseAudio PID file is created,
-*               using inotify
+* Date: 10/19/2026
+* Description: Startup task that reads the settings of the sound device and
+*       decodes the embedded sounds. Neither needs the user to be logged in,
+*       so it runs while the client waits for the login.
 *
 * Parameters:
-*        pidLocation    I/P     char*   string of the location of the PID file
+*        arg            I/O     void*   The Sound_Device to load settings into
+*        loadTask       O/P     void*   Unused
 **************************************************************************/
-int blockForPA_PID(char* pidLocation)
-///TODO: It may be to complicated to use this, might be easier to wait by
-///polling the PID file. Need to fix this to avoid race conditions and over-
-///engineering
+void* loadTask(void* arg)
 {
-        char dir[100];
-        strcpy(dir, pidLocation);
-        dir[strlen(dir) - 4] = '\000';
-        /*obtain just the "pulse" folder*/
-
-
-        const size_t buff_size = sizeof(struct inotify_event) + NAME_MAX + 1;
-        /*obtain the size of the inotify event*/
-        struct inotify_event* event = (struct inotify_event*)malloc(buff_size);
-        /*dynamically allocate the inotify event*/
-        int fd, wd;
-        /*file decriptors of the initializer and watchdogs*/
-        fd = inotify_init();
-        /*Initialize the Inotify instance*/
-
-        if(fd < 0){
-        /*if failed to initialize, return false*/
-                return 0;
+        Sound_Device *device = (Sound_Device*)arg;
+
+        device->deviceName = getenv("DINGER_PCM_DEVICE");
+        if(device->deviceName == NULL || *device->deviceName == '\000')
+        /*unless a direct hw: or plughw: device was asked for, play through
+        * the default device*/
+                device->deviceName = PCM_DEVICE;
+        device->periodTime = getConfigUInt("DINGER_PERIOD_US", PERIOD_TIME);
+        device->bufferTime = getConfigUInt("DINGER_BUFFER_US", BUFFER_TIME);
+        /*Obtain the target latency of the PCM device*/
+
+        if(getConfigUInt("DINGER_CALIBRATE", 0)){
+        /*If calibration mode is on, look up the stored latency of the device*/
+                g_haveStoredLatency = loadLatency(device->deviceName,
+                                                &(device->periodTime),
+                                                &(device->bufferTime));
+                if(g_haveStoredLatency)
+                        LOGMSG(LOG_NOTICE, "Using stored latency of %s: "
+                                "period %u us, buffer %u us\n",
+                                device->deviceName, device->periodTime,
+                                device->bufferTime);
         }
+        markPhase("config loaded");
 
-        wd = inotify_add_watch(fd, dir, IN_CREATE);
-        /*add a watchdog for when the pulseaaudio PID file is created*/
-
-        if(wd < 0)
-        /*if it failed to add the watch, return false*/
-                return 0;
-
-
-        do{
-
-                int ret = read(fd, event, buff_size);
-                /*block until an inotify event is read*/
-                if(ret < 0)
-                        return 0;
-
-        }while(0 != strcmp("pid", event->name));
-
-        free(event);
-        /*free the event buffer*/
-        inotify_rm_watch(fd, wd);
-        /*remove the watchdog*/
-        close(fd);
-        /*close the inotify file descriptor*/
-
-        return 1;
+        if(decodeAssets() == 0){
+                LOGMSG(LOG_ERR, "Failed to decode sounds");
+                failedShutdown();
+        }
+        markPhase("sounds decoded");
 
+        return NULL;
 }
 
-
-/*INCOMPLETE*/
-int wait_for_dir_creation(int fd, char* path, char* objName)
+/***************************************************************************
+* void openAudio(Sound_Device *device)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Faults in the converted sounds
+* Description: Function that waits for PulseAudio, opens the PCM device and
+*       converts the decoded sounds into its format. The null and capture
+*       outputs skip straight to opening. It runs on the audio
+*       thread while the client waits for the server, or on the first event in
+*       lazy mode.
+*
+* Parameters:
+*        device         I/O     Sound_Device*   The PCM device to open
+**************************************************************************/
+void openAudio(Sound_Device *device)
 {
+        pthread_join(g_loadThread, NULL);
+        /*the settings have to be loaded first*/
 
-        const size_t buff_size = sizeof(struct inotify_event) + NAME_MAX + 1;
-        /*obtain the size of the inotify event*/
-        struct inotify_event* event = (struct inotify_event*)malloc(buff_size);
-        /*dynamically allocate the inotify event*/
-
-        _Atomic int wd = inotify_add_watch(fd, path, IN_CREATE);
-
-        if(wd < 0 && errno == ENOENT){
-        /*if it failed to create watchdog because the parent dir does not
-        * exist, then create a new watchdog for the parent
-        */
-                char tmp[50];
-                char tmpObj[50];
-                strcpy(tmp, path);
-
-                ///TODO: verify that this is correct formatting
-                int q = strlen(tmp);
-                while(tmp[q]!='/')
-                        q--;
-
-                memcpy(tmpObj, tmp+q+1, strlen(tmp)-q);
-                tmp[q] = '\000';
-                /*Attempt to split the waiting dir/file up by name and location
-                * path
-                */
-
-                int rep = wait_for_dir_creation(fd, tmp, tmpObj);
-                /*if it had failed to wait for file/dir, then get the parent
-                * dir and pass it as a child to the waiting function
-                */
-
-                return rep;
-
-        }
-        else if(wd < 0){
-        /*otherwise, it failed for other reasons*/
-                return 0;
+        if(device->sink != &g_alsaSink){
+        /*the other outputs don't need a sound server or calibrating*/
+                if(device->sink->open(device) == 0)
+                        failedShutdown();
+                markPhase("output opened");
+                if(prepareAssets(device) == 0){
+                        LOGMSG(LOG_ERR, "Failed to convert sounds");
+                        failedShutdown();
+                }
+                lockSounds();
+                markPhase("sounds converted");
+                return;
         }
 
-        do{
+        char pulse_pid[100];
+        getUserDir(pulse_pid);
+        /*obtain the location of the pulseaudio pid file*/
 
+        memcpy(pulse_pid+strlen(pulse_pid), "/pulse/pid", 11);
+        /*Complete the path of the PID file*/
 
-        int reply = read(fd, event, buff_size);
-        ///TODO: Possible race condition, need to garuntee that the dir/file
-        ///hasn't been created between the time of checking and waiting
+        uint pulseWait = getConfigUInt("DINGER_PULSE_WAIT_MS", 0);
+        /*how long to wait for PulseAudio, 0 waits forever*/
+        if(waitForPath(pulse_pid, pulseWait ? (int)pulseWait : -1) == 0){
+        /*wait for the creation of the PulseAudio PID file. If it never shows
+        * up (ie there is no PulseAudio) carry on without it*/
+                LOGMSG(LOG_ALERT, "Gave up waiting for PulseAudio PID: %m");
+        }
+        markPhase("sound server ready");
 
-        if(reply < 0)
-                return 0;
+        if(getConfigUInt("DINGER_CALIBRATE", 0) && !g_haveStoredLatency){
+        /*If calibration mode is on and nothing was stored for the device,
+        * probe for its latency now*/
+                calibrateLatency(device);
+                markPhase("calibrated");
+        }
 
-        }while(0 != strcmp(event->name, objName));
+        if(setup(device) == 0){
+        /*Set up the sound PCM device*/
+                LOGMSG(LOG_ERR, "Failed to set up sound devices: %m");
+                failedShutdown();
+        }
+        markPhase("PCM opened");
 
-        free(event);
-        /*free the event buffer*/
-        inotify_rm_watch(fd, wd);
-        /*remove the watchdog*/
-        close(fd);
-        /*close the inotify file descriptor*/
+        if(prepareAssets(device) == 0){
+        /*Convert the sounds into the format the device negotiated*/
+                LOGMSG(LOG_ERR, "Failed to convert sounds");
+                failedShutdown();
+        }
+        lockSounds();
+        markPhase("sounds converted");
+}
 
-        return 1;
+/***************************************************************************
+* void lockSounds(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that faults in the converted sounds, which are what
+*       the audio thread actually plays, and the audio thread's stack, when
+*       memory is locked
+*
+* Parameters: N/A
+**************************************************************************/
+void lockSounds(void)
+{
+        Memory_Region sounds[2 + CLICK_CLASSES];
+        size_t count = 0;
 
+        if(!g_memoryLocked)
+                return;
 
+        sounds[count].addr = g_capsOnAsset.data;
+        sounds[count++].len = g_capsOnAsset.size;
+        sounds[count].addr = g_capsOffAsset.data;
+        sounds[count++].len = g_capsOffAsset.size;
+        for(int i = 0; i < CLICK_CLASSES; i++){
+                sounds[count].addr = g_clickAsset[i].data;
+                sounds[count++].len = g_clickAsset[i].size;
+        }
+        lockMemory(sounds, count);
 }
 
-
-
 /***************************************************************************
 * void getUserDir(char* location)
 * Author: SkibbleBip
@@ -760,49 +905,52 @@ void getPIDlocation(char* in)
 
         if(NULL==dir){
         /*if the directory doesn't exist, then set the input as blank*/
-                syslog(LOG_NOTICE, "%s does not exist\n", in);
+                LOGMSG(LOG_NOTICE, "%s does not exist\n", in);
                 in[0] = '\000';
                 return;
         }
 
         if(0 != closedir(dir)){
-                syslog(LOG_ALERT,"Failed to close %s: %m", in);
+                LOGMSG(LOG_ALERT,"Failed to close %s: %m", in);
         }
 
         //char tmp[100];
         memcpy(in+strlen(in), "/CapsLockClient.pid", 20);
         /*terminate the string with the name of the PID file*/
-        syslog(LOG_NOTICE, "PID file is %s\n", in);
+        LOGMSG(LOG_NOTICE, "PID file is %s\n", in);
 }
 
 /***************************************************************************
-* void shutdown(int sig)
+* void shutdownDaemon(int sig)
 * Author: SkibbleBip
-* Date: 05/23/2021
-* Description: Signal handler to process the shutdown procedures
+* Date: 05/23/2021      v1: Initial
+* Date: 10/19/2026      v2: Leaves closing the output to the audio thread
+* Date: 10/19/2026      v3: Called from the main loop instead of the handler
+* Description: Function that processes the shutdown procedures once
+*       stopHandler has caught a signal to exit. It runs on the main thread,
+*       outside the handler, so it can log and exit safely.
 *
 * Parameters:
 *        sig    I/P     int     Signal value
 **************************************************************************/
-void shutdown(int sig){
+void shutdownDaemon(int sig){
 
-        syslog(LOG_NOTICE, "Received signal %d to exit\n", sig);
-        close(g_pipeLocation);
+        LOGMSG(LOG_NOTICE, "Received signal %d to exit\n", sig);
+        transportClose(&g_channel);
         close(g_pidfile);
         /*Close the pipe and PID file*/
-        snd_pcm_drain(g_pcmHandle);
-        snd_pcm_close(g_pcmHandle);
-        /*drain and close the PCM handle*/
+        stopAudioThread(&g_audio);
+        /*the audio thread drains and closes the output it owns*/
 
         char buff[100];
         getPIDlocation(buff);
         /*Obtain the ID location of the client service*/
         if(remove(buff) != 0){
         /*attempt to remove PID file*/
-                syslog(LOG_ERR, "Failed to remove PID file: %m");
+                LOGMSG(LOG_ERR, "Failed to remove PID file: %m");
         }
 
-	syslog(LOG_NOTICE, "Closed. Goodbye!");
+	LOGMSG(LOG_NOTICE, "Closed. Goodbye!");
 	exit(0);
 
 
@@ -810,7 +958,8 @@ void shutdown(int sig){
 /***************************************************************************
 * void failedShutdown(void)
 * Author: SkibbleBip
-* Date: 06/03/2021
+* Date: 06/03/2021      v1: Initial
+* Date: 10/19/2026      v2: Leaves closing the output to the audio thread
 * Description: Function that concludes the shutdown procedures in the event
 *       that an error were to occur
 *
@@ -818,21 +967,20 @@ void shutdown(int sig){
 **************************************************************************/
 void failedShutdown(void)
 {
-        syslog(LOG_CRIT, "Requesting shutdown due to failure\n");
-        close(g_pipeLocation);
+        LOGMSG(LOG_CRIT, "Requesting shutdown due to failure\n");
+        transportClose(&g_channel);
         /*close the pipe*/
         close(g_pidfile);
         /*close the PID file (automatically unlocked)*/
-        snd_pcm_drain(g_pcmHandle);
-        snd_pcm_close(g_pcmHandle);
-        /*drain and close the PCM handle*/
+        stopAudioThread(&g_audio);
+        /*the audio thread drains and closes the output it owns*/
 
         char buff[100];
         getPIDlocation(buff);
         /*obtain the PID location*/
         if(remove(buff) != 0){
         /*remove the PID file. If failed, syslog the error and exit*/
-                syslog(LOG_ERR,
+                LOGMSG(LOG_ERR,
                         "Failed to remove PID file: %m!\n"//,
                         //strerror(errno)
                 );
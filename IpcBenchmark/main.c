@@ -0,0 +1,325 @@
+/***************************************************************************
+* File:  main.c
+* Author:  SkibbleBip
+* Measures each transport between the server and client, to choose one for a
+* machine from numbers. For every transport a receiver is forked that
+* connects and reads the way the client does, blocking in poll between
+* batches. The sender first sends LATENCY_MESSAGES one at a time with a gap
+* between them, so the receiver is asleep each time, and the receiver takes
+* the distribution of how long each took from send to read. Then it sends
+* RATE_MESSAGES one per send as fast as it can, for the most messages per
+* second. Build it with
+*
+*       gcc -O2 -o ipcbenchmark IpcBenchmark/main.c -lm -pthread
+*
+* and give it -j for one JSON object per line, or the names of the transports
+* to run.
+* Procedures:
+* cmpNs                 -Function that orders two times
+* percentile            -Function that returns a percentile of sorted times
+* receiver              -The receiving side, run in the forked process
+* sender                -The sending side
+* runTransport          -Function that measures one transport
+* main                  -The main function
+***************************************************************************/
+
+#define _GNU_SOURCE
+/*for pipe2, accept4 and memfd_create in Transport.h*/
+
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <sched.h>
+
+#include "../main.h"
+#include "../Transport.h"
+
+#define         LATENCY_MESSAGES        20000
+/*Messages timed one by one*/
+#define         LATENCY_GAP             50000
+/*Nanoseconds between them, long enough for the receiver to go to sleep*/
+#define         RATE_MESSAGES           200000
+/*Messages sent as fast as possible*/
+#define         CONNECT_RETRY           1000000
+/*Nanoseconds between attempts to connect before the sender is there*/
+
+
+/*Definitions of functions*/
+int cmpNs(const void* a, const void* b);
+double percentile(const int64_t* sorted, uint count, double p);
+int receiver(const char* path, const char* name, int json);
+int sender(Channel* c);
+int runTransport(const Transport* t, int json);
+
+int main(int argc, char** argv);
+
+
+/***************************************************************************
+* int cmpNs(const void* a, const void* b)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that orders two times, for qsort
+*
+* Parameters:
+*        a      I/P     const void*     The first time
+*        b      I/P     const void*     The second time
+*        cmpNs  O/P     int             The order of the two
+**************************************************************************/
+int cmpNs(const void* a, const void* b)
+{
+        int64_t x = *(const int64_t*)a;
+        int64_t y = *(const int64_t*)b;
+        return x < y ? -1 : x > y;
+}
+
+/***************************************************************************
+* double percentile(const int64_t* sorted, uint count, double p)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns a percentile of sorted times, in
+*       microseconds
+*
+* Parameters:
+*        sorted         I/P     const int64_t*  The times, in nanoseconds
+*        count          I/P     uint            Number of times
+*        p              I/P     double          The percentile, 0 to 100
+*        percentile     O/P     double          The time at it
+**************************************************************************/
+double percentile(const int64_t* sorted, uint count, double p)
+{
+        if(count == 0)
+                return 0;
+        uint i = (uint)(p / 100.0 * (count - 1) + 0.5);
+        return sorted[i] / 1000.0;
+}
+
+/***************************************************************************
+* int receiver(const char* path, const char* name, int json)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The receiving side. It connects like the client, then waits
+*       with poll and reads until the sender closes, noting when each timed
+*       message arrived and when the last of the rate test did, and prints
+*       the results.
+*
+* Parameters:
+*        path           I/P     const char*     Where the sender listens
+*        name           I/P     const char*     Name of the transport
+*        json           I/P     int             Whether to print JSON
+*        receiver       O/P     int             The exit status
+**************************************************************************/
+int receiver(const char* path, const char* name, int json)
+{
+        const struct timespec retry = {0, CONNECT_RETRY};
+        Channel c;
+        Lock_Message received[TRANSPORT_PACKET];
+        int64_t* latency = (int64_t*)malloc(LATENCY_MESSAGES * sizeof(int64_t));
+        uint timed = 0;
+        uint counted = 0;
+        int64_t rateStart = 0;
+        int64_t rateEnd = 0;
+        uint wakeups = 0;
+
+        if(latency == NULL)
+                return -1;
+        while(!transportConnect(&c, path)){
+                if(errno != ENOENT && errno != ECONNREFUSED && errno != EINTR){
+                        perror("Failed to connect");
+                        return -1;
+                }
+                nanosleep(&retry, NULL);
+        }
+
+        while(1){
+                struct pollfd pfd = {c.fd, POLLIN, 0};
+                if(poll(&pfd, 1, -1) < 0){
+                        if(errno == EINTR)
+                                continue;
+                        perror("Failed to poll");
+                        return -1;
+                }
+                wakeups++;
+
+                ssize_t n;
+                while((n = c.t->receive(&c, received, TRANSPORT_PACKET)) > 0){
+                        int64_t now = getBoottimeNs();
+                        for(ssize_t i = 0; i < n; i++){
+                                if(received[i].seq < LATENCY_MESSAGES){
+                                        latency[timed++] = now - received[i].kernelNs;
+                                        continue;
+                                }
+                                if(rateStart == 0)
+                                        rateStart = received[i].kernelNs;
+                                rateEnd = now;
+                                counted++;
+                        }
+                }
+                if(n == 0)
+                /*the sender is done*/
+                        break;
+                if(errno != EAGAIN && errno != EINTR){
+                        perror("Failed to receive");
+                        return -1;
+                }
+        }
+        transportClose(&c);
+
+        qsort(latency, timed, sizeof(int64_t), cmpNs);
+        double rate = rateEnd > rateStart
+                        ? counted * 1e9 / (rateEnd - rateStart) : 0;
+        uint lost = LATENCY_MESSAGES + RATE_MESSAGES - timed - counted;
+
+        if(json)
+                printf("{\"transport\":\"%s\",\"p50_us\":%.2f,\"p90_us\":%.2f,"
+                        "\"p99_us\":%.2f,\"p999_us\":%.2f,\"max_us\":%.2f,"
+                        "\"msgs_per_s\":%.0f,\"lost\":%u,\"wakeups\":%u}\n",
+                        name, percentile(latency, timed, 50),
+                        percentile(latency, timed, 90),
+                        percentile(latency, timed, 99),
+                        percentile(latency, timed, 99.9),
+                        percentile(latency, timed, 100), rate, lost, wakeups);
+        else
+                printf("%-10s %8.2f %8.2f %8.2f %8.2f %9.2f %12.0f %7u %8u\n",
+                        name, percentile(latency, timed, 50),
+                        percentile(latency, timed, 90),
+                        percentile(latency, timed, 99),
+                        percentile(latency, timed, 99.9),
+                        percentile(latency, timed, 100), rate, lost, wakeups);
+
+        free(latency);
+        return 0;
+}
+
+/***************************************************************************
+* int sender(Channel* c)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The sending side, once the receiver has connected. Each
+*       message is stamped with the boot clock as it is sent. When the shared
+*       ring is full it yields for the receiver to catch up, the pipes and
+*       sockets block by themselves.
+*
+* Parameters:
+*        c              I/O     Channel*        The channel
+*        sender         O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int sender(Channel* c)
+{
+        const struct timespec gap = {0, LATENCY_GAP};
+        Lock_Message m;
+
+        memset(&m, 0, sizeof(m));
+        for(uint32_t seq = 0; seq < LATENCY_MESSAGES + RATE_MESSAGES; seq++){
+                m.seq = seq;
+                m.status = (Status_t)(seq % (2 * TOGGLE_AXIS));
+                m.kernelNs = getBoottimeNs();
+                while(!transportSend(c, &m, 1)){
+                        if(errno != EAGAIN && errno != EINTR){
+                                perror("Failed to send");
+                                return 0;
+                        }
+                        sched_yield();
+                }
+                if(seq < LATENCY_MESSAGES)
+                        nanosleep(&gap, NULL);
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int runTransport(const Transport* t, int json)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that measures one transport, listening at a path of
+*       its own in /tmp so a running server is left alone
+*
+* Parameters:
+*        t              I/P     const Transport*        The transport
+*        json           I/P     int     Whether to print JSON
+*        runTransport   O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int runTransport(const Transport* t, int json)
+{
+        char path[64];
+        Channel c;
+        int status;
+
+        snprintf(path, sizeof(path), "/tmp/dinger-ipc-%d", getpid());
+        unlink(path);
+        fflush(stdout);
+        /*so the receiver doesn't print what is buffered again*/
+
+        pid_t pid = fork();
+        if(pid < 0){
+                perror("Failed to fork");
+                return 0;
+        }
+        if(pid == 0)
+                exit(receiver(path, t->name, json));
+
+        selectTransport(&c, path);
+        c.t = t;
+        int ok = transportListen(&c);
+        if(!ok)
+                perror("Failed to listen");
+        else
+                ok = sender(&c);
+        transportClose(&c);
+        /*the receiver sees the end, and prints*/
+        unlink(path);
+
+        if(!ok)
+                kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/***************************************************************************
+* int main(int argc, char** argv)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The main function
+*
+* Parameters:
+*        argc   I/P     int     Number of arguments
+*        argv   I/P     char**  -j, and the transports to run
+*        main   O/P     int     The return value
+**************************************************************************/
+int main(int argc, char** argv)
+{
+        const size_t kinds = sizeof(g_transports) / sizeof(g_transports[0]);
+        int json = 0;
+        int chosen = 0;
+        int failed = 0;
+
+        signal(SIGPIPE, SIG_IGN);
+        for(int i = 1; i < argc; i++){
+                if(strcmp(argv[i], "-j") == 0)
+                        json = 1;
+                else
+                        chosen++;
+        }
+
+        if(json)
+                printf("{\"latency_messages\":%d,\"gap_us\":%d,"
+                        "\"rate_messages\":%d}\n", LATENCY_MESSAGES,
+                        LATENCY_GAP / 1000, RATE_MESSAGES);
+        else
+                printf("%-10s %8s %8s %8s %8s %9s %12s %7s %8s\n", "transport",
+                        "p50 us", "p90 us", "p99 us", "p99.9 us", "max us",
+                        "msgs/s", "lost", "wakeups");
+
+        for(size_t k = 0; k < kinds; k++){
+                int run = chosen == 0;
+                for(int i = 1; i < argc && !run; i++)
+                        run = strcmp(argv[i], g_transports[k]->name) == 0;
+                if(run && !runTransport(g_transports[k], json)){
+                        fprintf(stderr, "Failed to measure %s\n",
+                                g_transports[k]->name);
+                        failed = 1;
+                }
+        }
+
+        return failed ? -1 : 0;
+}
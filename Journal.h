@@ -0,0 +1,224 @@
+/***************************************************************************
+* File:  Journal.h
+* Author:  SkibbleBip
+* Flight recorder of lock changes. Each daemon keeps a fixed size ring of
+* entries in a memory mapped file, so recording costs a few stores and what
+* happened survives a crash or restart. Entries are in the order each daemon
+* saw the lock changes, and the server's and client's are matched up by
+* sequence number. JournalDump reads them back into a latency table.
+* Procedures:
+* journalOpen           -Function that maps the journal file, keeping the
+*                               entries already in it
+* journalAt             -Function that returns the entry at a position
+* journalNext           -Function that claims the next entry
+* journalOutcomeName    -Function that names an outcome
+***************************************************************************/
+
+#ifndef JOURNAL_H_INCLUDED
+#define JOURNAL_H_INCLUDED
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "main.h"
+
+#define         JOURNAL_MAGIC   0x4e52444a
+/*"JDRN", marks a journal file*/
+#define         JOURNAL_VERSION 1
+#define         JOURNAL_ENTRIES 4096
+/*Number of entries in the ring, must be a power of 2*/
+
+
+/*What became of a lock change*/
+typedef enum {  OUTCOME_NONE,
+                OUTCOME_SENT,
+                /*the server sent it to the client*/
+                OUTCOME_UNSENT,
+                /*the server could not send it, the client was gone*/
+                OUTCOME_RECEIVED,
+                /*the client received it and has not decided yet*/
+                OUTCOME_COALESCED,
+                /*a later change of the same lock in the batch replaced it*/
+                OUTCOME_UNCHANGED,
+                /*the lock was already in that state*/
+                OUTCOME_STALE,
+                /*it was too old to ding for*/
+                OUTCOME_DROPPED,
+                /*the audio queue was full*/
+                OUTCOME_QUEUED,
+                /*waiting for the audio thread*/
+                OUTCOME_PLAYED
+        } Journal_Outcome;
+
+/*Struct to contain one lock change. Times are CLOCK_BOOTTIME nanoseconds, 0
+* if that stage did not happen in this daemon*/
+typedef struct {
+        uint32_t seq;
+        uint16_t status;
+        uint16_t outcome;
+        int64_t kernelNs;
+        int64_t decodeNs;
+        int64_t sendNs;
+        int64_t receiveNs;
+        int64_t playNs;
+} Journal_Entry;
+
+/*Struct to contain the start of the journal file*/
+typedef struct {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entries;
+        uint32_t entrySize;
+        char role[16];
+        /*which daemon wrote it*/
+        int32_t pid;
+        uint32_t unused;
+        uint64_t head;
+        /*how many entries were ever claimed*/
+} Journal_Header;
+
+/*Struct to contain an open journal*/
+typedef struct {
+        Journal_Header* header;
+        Journal_Entry* entries;
+        size_t size;
+} Journal;
+
+Journal g_journal;
+
+
+/***************************************************************************
+* int journalOpen(Journal* j, const char* path, const char* role)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that maps the journal file, creating it if needed. If
+*       it already holds a journal of the same layout, its entries are kept
+*       and new ones follow them, so the history from before a restart can
+*       still be dumped. If it can't be opened the daemon runs without one.
+*
+* Parameters:
+*        j              I/O     Journal*        The journal to open
+*        path           I/P     const char*     Path of the journal file
+*        role           I/P     const char*     Name of the daemon
+*        journalOpen    O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int journalOpen(Journal* j, const char* path, const char* role)
+{
+        struct stat st;
+
+        memset(j, 0, sizeof(*j));
+        j->size = sizeof(Journal_Header) + JOURNAL_ENTRIES * sizeof(Journal_Entry);
+
+        int fd = open(path, O_RDWR|O_CREAT|O_CLOEXEC, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+        if(fd < 0 || fstat(fd, &st) < 0
+                || ((size_t)st.st_size != j->size && ftruncate(fd, j->size) < 0)){
+                LOGMSG(LOG_ALERT, "Failed to open journal %s: %m", path);
+                if(fd >= 0)
+                        close(fd);
+                return 0;
+        }
+
+        void* map = mmap(NULL, j->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        /*the mapping keeps the file open*/
+        if(map == MAP_FAILED){
+                LOGMSG(LOG_ALERT, "Failed to map journal %s: %m", path);
+                return 0;
+        }
+
+        j->header = (Journal_Header*)map;
+        j->entries = (Journal_Entry*)((char*)map + sizeof(Journal_Header));
+
+        if(j->header->magic != JOURNAL_MAGIC
+                || j->header->version != JOURNAL_VERSION
+                || j->header->entries != JOURNAL_ENTRIES
+                || j->header->entrySize != sizeof(Journal_Entry)){
+        /*a new file, or one from a different build, so start it over*/
+                memset(map, 0, j->size);
+                j->header->magic = JOURNAL_MAGIC;
+                j->header->version = JOURNAL_VERSION;
+                j->header->entries = JOURNAL_ENTRIES;
+                j->header->entrySize = sizeof(Journal_Entry);
+        }
+        snprintf(j->header->role, sizeof(j->header->role), "%s", role);
+        j->header->pid = getpid();
+
+        LOGMSG(LOG_NOTICE, "Journal %s opened with %llu entries recorded\n",
+                path, (unsigned long long)j->header->head);
+        return 1;
+}
+
+/***************************************************************************
+* Journal_Entry* journalAt(Journal* j, uint64_t pos)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the entry at a position of the ring, or
+*       NULL if the daemon has no journal
+*
+* Parameters:
+*        j              I/P     Journal*        The journal
+*        pos            I/P     uint64_t        The position
+*        journalAt      O/P     Journal_Entry*  The entry
+**************************************************************************/
+Journal_Entry* journalAt(Journal* j, uint64_t pos)
+{
+        if(j->header == NULL)
+                return NULL;
+        return &j->entries[pos & (JOURNAL_ENTRIES - 1)];
+}
+
+/***************************************************************************
+* Journal_Entry* journalNext(Journal* j, uint64_t* pos)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that claims the next entry of the ring, overwriting
+*       the oldest once it is full. The entry is cleared. Only one thread of a
+*       daemon claims entries.
+*
+* Parameters:
+*        j              I/O     Journal*        The journal
+*        pos            I/O     uint64_t*       Position of the entry, may be
+*                                               NULL
+*        journalNext    O/P     Journal_Entry*  The entry, or NULL if the
+*                                               daemon has no journal
+**************************************************************************/
+Journal_Entry* journalNext(Journal* j, uint64_t* pos)
+{
+        if(j->header == NULL)
+                return NULL;
+
+        uint64_t head = j->header->head;
+        Journal_Entry* e = &j->entries[head & (JOURNAL_ENTRIES - 1)];
+        memset(e, 0, sizeof(*e));
+        __atomic_store_n(&j->header->head, head + 1, __ATOMIC_RELEASE);
+        if(pos != NULL)
+                *pos = head;
+        return e;
+}
+
+/***************************************************************************
+* const char* journalOutcomeName(uint16_t outcome)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the name of an outcome
+*
+* Parameters:
+*        outcome                I/P     uint16_t        The outcome
+*        journalOutcomeName     O/P     const char*     Its name
+**************************************************************************/
+const char* journalOutcomeName(uint16_t outcome)
+{
+        const char* names[] = {"none", "sent", "unsent", "received",
+                                "coalesced", "unchanged", "stale", "dropped",
+                                "queued", "played"};
+
+        if(outcome >= sizeof(names) / sizeof(names[0]))
+                return "?";
+        return names[outcome];
+}
+
+
+#endif // JOURNAL_H_INCLUDED
@@ -0,0 +1,254 @@
+/***************************************************************************
+* File:  main.c
+* Author:  SkibbleBip
+* Reads the flight recorder journals of the server and client (or of the
+* standalone build), matches their entries up by sequence number and prints
+* one line per lock change with the time spent in each stage of the pipeline
+* and what became of it, ie
+*
+*       journaldump /var/run/CapsLockServer.journal \
+*               /run/user/1000/CapsLockClient.journal
+*
+* Procedures:
+* loadJournal           -Function that reads the entries of one journal file
+* cmpRows               -Function that orders the entries by kernel time
+* printStage            -Function that prints the time between two stages
+* printRow              -Function that prints one lock change
+* main                  -The main function
+***************************************************************************/
+
+#include <sys/file.h>
+#include <fcntl.h>
+
+#include "../main.h"
+#include "../Journal.h"
+
+#define         MAX_JOURNALS    4
+/*Most journal files read at once*/
+
+
+/*Struct to contain one lock change, merged from every journal that saw it*/
+typedef struct {
+        Journal_Entry entry;
+        uint16_t serverOutcome;
+        uint16_t clientOutcome;
+        /*what each side made of it, OUTCOME_NONE if it did not see it*/
+} Row;
+
+
+/*Definitions of functions*/
+size_t loadJournal(const char* path, Row* rows, size_t count);
+int cmpRows(const void* a, const void* b);
+void printStage(int64_t from, int64_t to);
+void printRow(const Row* row);
+
+int main(int argc, char** argv);
+
+
+/***************************************************************************
+* size_t loadJournal(const char* path, Row* rows, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads the entries of a journal file, oldest
+*       first, and adds them to the rows. Entries of the server are marked as
+*       the server's outcome, every other journal's as the client's.
+*
+* Parameters:
+*        path           I/P     const char*     The journal file
+*        rows           I/O     Row*            Room for JOURNAL_ENTRIES more
+*        count          I/P     size_t          Number of rows already loaded
+*        loadJournal    O/P     size_t          Number of rows added
+**************************************************************************/
+size_t loadJournal(const char* path, Row* rows, size_t count)
+{
+        Journal_Header header;
+        Journal_Entry* entries;
+        size_t added = 0;
+
+        int fd = open(path, O_RDONLY|O_CLOEXEC);
+        if(fd < 0){
+                fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+                return 0;
+        }
+        if(read(fd, &header, sizeof(header)) != sizeof(header)
+                || header.magic != JOURNAL_MAGIC
+                || header.version != JOURNAL_VERSION
+                || header.entries != JOURNAL_ENTRIES
+                || header.entrySize != sizeof(Journal_Entry)){
+                fprintf(stderr, "%s is not a journal of this version\n", path);
+                close(fd);
+                return 0;
+        }
+
+        entries = (Journal_Entry*)malloc(JOURNAL_ENTRIES * sizeof(Journal_Entry));
+        if(entries == NULL
+                || read(fd, entries, JOURNAL_ENTRIES * sizeof(Journal_Entry))
+                        != JOURNAL_ENTRIES * sizeof(Journal_Entry)){
+                fprintf(stderr, "Failed to read %s\n", path);
+                free(entries);
+                close(fd);
+                return 0;
+        }
+        close(fd);
+
+        header.role[sizeof(header.role) - 1] = '\000';
+        int server = strcmp(header.role, "server") == 0;
+        uint64_t first = header.head > JOURNAL_ENTRIES
+                                ? header.head - JOURNAL_ENTRIES : 0;
+        /*the ring only holds the newest JOURNAL_ENTRIES*/
+
+        printf("# %s: %s (pid %d), %llu lock changes, %llu kept\n", path,
+                header.role, header.pid, (unsigned long long)header.head,
+                (unsigned long long)(header.head - first));
+
+        for(uint64_t pos = first; pos < header.head; pos++){
+                Row* row = &rows[count + added++];
+                memset(row, 0, sizeof(*row));
+                row->entry = entries[pos & (JOURNAL_ENTRIES - 1)];
+                if(server)
+                        row->serverOutcome = row->entry.outcome;
+                else
+                        row->clientOutcome = row->entry.outcome;
+        }
+
+        free(entries);
+        return added;
+}
+
+/***************************************************************************
+* int cmpRows(const void* a, const void* b)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that orders the rows by kernel time and then sequence
+*       number, so the server's and client's entries of one lock change end up
+*       next to each other
+*
+* Parameters:
+*        a              I/P     const void*     The first row
+*        b              I/P     const void*     The second row
+*        cmpRows        O/P     int             The order of the two
+**************************************************************************/
+int cmpRows(const void* a, const void* b)
+{
+        const Journal_Entry* x = &((const Row*)a)->entry;
+        const Journal_Entry* y = &((const Row*)b)->entry;
+
+        if(x->kernelNs != y->kernelNs)
+                return x->kernelNs < y->kernelNs ? -1 : 1;
+        if(x->seq != y->seq)
+                return x->seq < y->seq ? -1 : 1;
+        return 0;
+}
+
+/***************************************************************************
+* void printStage(int64_t from, int64_t to)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that prints the microseconds between two stages, or a
+*       dash if either did not happen
+*
+* Parameters:
+*        from   I/P     int64_t         When the first stage happened
+*        to     I/P     int64_t         When the second stage happened
+**************************************************************************/
+void printStage(int64_t from, int64_t to)
+{
+        if(from == 0 || to == 0)
+                printf(" %10s", "-");
+        else
+                printf(" %10.1f", (to - from) / 1000.0);
+}
+
+/***************************************************************************
+* void printRow(const Row* row)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that prints one lock change and the time spent in
+*       each stage, in microseconds
+*
+* Parameters:
+*        row    I/P     const Row*      The lock change
+**************************************************************************/
+void printRow(const Row* row)
+{
+        const Journal_Entry* e = &row->entry;
+
+        printf("%10u %-10s %-3s", e->seq, g_ledNames[e->status % TOGGLE_AXIS],
+                e->status < TOGGLE_AXIS ? "on" : "off");
+        printStage(e->kernelNs, e->decodeNs);
+        printStage(e->decodeNs, e->sendNs);
+        printStage(e->sendNs, e->receiveNs);
+        printStage(e->receiveNs != 0 ? e->receiveNs : e->decodeNs, e->playNs);
+        /*the standalone build plays straight after decoding*/
+        printStage(e->kernelNs, e->playNs);
+        printf("  %s", journalOutcomeName(row->clientOutcome != OUTCOME_NONE
+                                        ? row->clientOutcome
+                                        : row->serverOutcome));
+        if(row->clientOutcome == OUTCOME_NONE
+                && row->serverOutcome == OUTCOME_SENT)
+        /*the client has no record of it, so it never arrived*/
+                printf(" (not in the client journal)");
+        printf("\n");
+}
+
+/***************************************************************************
+* int main(int argc, char** argv)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The main function
+*
+* Parameters:
+*        argc   I/P     int     Number of arguments
+*        argv   I/P     char**  The journal files
+*        main   O/P     int     The return value
+**************************************************************************/
+int main(int argc, char** argv)
+{
+        if(argc < 2 || argc > MAX_JOURNALS + 1){
+                fprintf(stderr, "Usage: %s JOURNAL...\n"
+                        "Prints the lock changes recorded in the server, client "
+                        "or standalone journals\n", argv[0]);
+                return -1;
+        }
+
+        Row* rows = (Row*)malloc((size_t)(argc - 1) * JOURNAL_ENTRIES * sizeof(Row));
+        if(rows == NULL){
+                perror("Failed to allocate rows");
+                return -1;
+        }
+
+        size_t count = 0;
+        for(int i = 1; i < argc; i++)
+                count += loadJournal(argv[i], rows, count);
+        qsort(rows, count, sizeof(Row), cmpRows);
+
+        size_t merged = 0;
+        for(size_t i = 0; i < count; i++){
+        /*fold the entries the server and client made of the same change into
+        * one row, the client's having the later stages*/
+                Row* prev = merged > 0 ? &rows[merged - 1] : NULL;
+                if(prev != NULL && cmpRows(prev, &rows[i]) == 0){
+                        Journal_Entry* e = &prev->entry;
+                        const Journal_Entry* o = &rows[i].entry;
+                        if(e->decodeNs == 0)    e->decodeNs = o->decodeNs;
+                        if(e->sendNs == 0)      e->sendNs = o->sendNs;
+                        if(e->receiveNs == 0)   e->receiveNs = o->receiveNs;
+                        if(e->playNs == 0)      e->playNs = o->playNs;
+                        if(prev->serverOutcome == OUTCOME_NONE)
+                                prev->serverOutcome = rows[i].serverOutcome;
+                        if(prev->clientOutcome == OUTCOME_NONE)
+                                prev->clientOutcome = rows[i].clientOutcome;
+                        continue;
+                }
+                rows[merged++] = rows[i];
+        }
+
+        printf("%10s %-10s %-3s %10s %10s %10s %10s %10s  %s\n", "seq", "lock", "",
+                "decode us", "send us", "receive us", "play us", "total us",
+                "outcome");
+        for(size_t i = 0; i < merged; i++)
+                printRow(&rows[i]);
+
+        free(rows);
+        return 0;
+}
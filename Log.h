@@ -0,0 +1,442 @@
+/***************************************************************************
+* File:  Log.h
+* Author:  SkibbleBip
+* Asynchronous, rate limited logging. LOGMSG formats the message into a lock
+* free ring and wakes a background thread that hands it to syslog, so the
+* event loops and signal handlers never wait on syslog or journald. Each call
+* site may log LOG_BURST messages every LOG_WINDOW; the rest are counted, and
+* the log thread reports the counts once a window, so a repeating error can't
+* flood the log. LOGMSG_ALL skips the limit, for the few sites that log a
+* bounded table of lines at once. If the ring is full the message is dropped
+* and counted. Until logStart is called, and in the tools without a log
+* thread, messages go straight to syslog.
+* Procedures:
+* logPush               -Function that adds a formatted message to the ring
+* logAllow              -Function that applies the rate limit of a call site
+* logMessage            -Function that formats and queues a message from a
+*                               call site
+* logDrain              -Function that writes the queued messages to syslog
+* logSweep              -Function that reports the messages every call site
+*                               has held back
+* logThreadMain         -The log thread, which drains the ring whenever woken
+* logFlush              -Function that waits a short while for the ring to be
+*                               written out
+* logStart              -Function that starts the log thread
+***************************************************************************/
+
+#ifndef LOG_H_INCLUDED
+#define LOG_H_INCLUDED
+
+#include <syslog.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#define         LOG_SIZE        256
+/*Number of messages the ring holds, must be a power of 2*/
+#define         LOG_TEXT        240
+/*Longest message kept, longer ones are cut short*/
+#define         LOG_BURST       10
+/*Messages each call site may log per window*/
+#define         LOG_WINDOW      1000000000LL
+/*Length of the rate limit window in nanoseconds*/
+#define         LOG_FLUSH_TIME  200
+/*Most milliseconds spent writing out the ring on exit*/
+#define         LOG_STACK       (128 * 1024)
+/*Stack size of the log thread, kept small so it fits in RLIMIT_MEMLOCK when
+* memory is locked*/
+
+
+/*Struct to contain the rate limit of one LOGMSG call site*/
+typedef struct Log_Site {
+        const char* file;
+        int line;
+        int64_t windowNs;
+        /*when the current window started*/
+        uint32_t count;
+        /*messages logged in the current window*/
+        uint32_t suppressed;
+        /*messages held back and not reported yet*/
+        int listed;
+        struct Log_Site* next;
+        /*whether the site is on the list the log thread sweeps, and the next
+        * one on it*/
+} Log_Site;
+
+/*Struct to contain one slot of the ring. seq tells the producers and the
+* log thread whose turn the slot is*/
+typedef struct {
+        uint32_t seq;
+        int priority;
+        char text[LOG_TEXT];
+} Log_Slot;
+
+/*Struct to contain the log ring. Any thread or signal handler may queue a
+* message, only the log thread takes them*/
+typedef struct {
+        Log_Slot slots[LOG_SIZE];
+        _Alignas(64) uint32_t tail;
+        /*next slot to claim, shared by every producer*/
+        _Alignas(64) uint32_t head;
+        /*next slot to write out, only moved by the log thread*/
+        uint32_t queued;
+        uint32_t written;
+        uint32_t dropped;
+        /*counters, also used by logFlush to tell when the ring is written*/
+        Log_Site* sites;
+        /*every call site that has held a message back, only ever added to*/
+        int suppressing;
+        /*set whenever a message is held back, so the log thread sweeps*/
+        sem_t doorbell;
+        pthread_t thread;
+        int running;
+} Log_Ring;
+
+Log_Ring g_log;
+
+
+#define LOGMSG(priority, ...) do{ \
+                static Log_Site logSite_ = {__FILE__, __LINE__, 0, 0, 0, 0, \
+                                                NULL}; \
+                logMessage(&logSite_, priority, __VA_ARGS__); \
+        }while(0)
+/*Logs a message from this call site, in the place of syslog()*/
+#define LOGMSG_ALL(priority, ...) logMessage(NULL, priority, __VA_ARGS__)
+/*Logs a message without a rate limit, for a site that logs a bounded number
+* of lines at once*/
+
+
+/***************************************************************************
+* void logPush(int priority, const char* text)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that adds a formatted message to the ring and wakes
+*       the log thread. Producers claim a slot by moving the tail along, and
+*       publish it through the slot's sequence number once the text is in, so
+*       it never blocks, and a signal handler that interrupts a producer
+*       simply claims the next slot. Without a log thread the message goes
+*       straight to syslog.
+*
+* Parameters:
+*        priority       I/P     int             The syslog priority
+*        text           I/P     const char*     The message
+**************************************************************************/
+void logPush(int priority, const char* text)
+{
+        if(!__atomic_load_n(&g_log.running, __ATOMIC_ACQUIRE)){
+                syslog(priority, "%s", text);
+                return;
+        }
+
+        uint32_t pos = __atomic_load_n(&g_log.tail, __ATOMIC_RELAXED);
+        Log_Slot* slot;
+        while(1){
+                slot = &g_log.slots[pos & (LOG_SIZE - 1)];
+                int32_t diff = (int32_t)(__atomic_load_n(&slot->seq,
+                                                __ATOMIC_ACQUIRE) - pos);
+                if(diff == 0){
+                /*the slot is free, try to claim it*/
+                        if(__atomic_compare_exchange_n(&g_log.tail, &pos, pos + 1,
+                                        1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                                break;
+                }
+                else if(diff < 0){
+                /*the log thread hasn't written this slot out yet, the ring is
+                * full*/
+                        __atomic_fetch_add(&g_log.dropped, 1, __ATOMIC_RELAXED);
+                        return;
+                }
+                else
+                /*another producer claimed it first*/
+                        pos = __atomic_load_n(&g_log.tail, __ATOMIC_RELAXED);
+        }
+
+        slot->priority = priority;
+        snprintf(slot->text, sizeof(slot->text), "%s", text);
+        __atomic_fetch_add(&g_log.queued, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+        /*publish the message only once it is written*/
+        sem_post(&g_log.doorbell);
+}
+
+/***************************************************************************
+* int logAllow(Log_Site* site)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that applies the rate limit of a call site. When a
+*       new window starts, the number of messages held back in the last one is
+*       logged first; if the site goes quiet instead, logSweep reports them.
+*       A site holding back its first message is added to the sweep list. Two
+*       threads logging from the same site at once may let a message more or
+*       less through, which doesn't matter.
+*
+* Parameters:
+*        site           I/O     Log_Site*       The call site
+*        logAllow       O/P     int     Bool-type return value of whether the
+*                                       message may be logged
+**************************************************************************/
+int logAllow(Log_Site* site)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t nowNs = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+        if(nowNs - __atomic_load_n(&site->windowNs, __ATOMIC_RELAXED)
+                        >= LOG_WINDOW){
+                __atomic_store_n(&site->windowNs, nowNs, __ATOMIC_RELAXED);
+                __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+                uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0,
+                                                        __ATOMIC_RELAXED);
+                if(suppressed > 0){
+                        char text[LOG_TEXT];
+                        snprintf(text, sizeof(text),
+                                "%u messages from %s:%d were suppressed\n",
+                                suppressed, site->file, site->line);
+                        logPush(LOG_NOTICE, text);
+                }
+        }
+
+        if(__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) < LOG_BURST)
+                return 1;
+        __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+        if(!__atomic_exchange_n(&site->listed, 1, __ATOMIC_RELAXED)){
+        /*sites are only ever pushed on the front, so this can't go wrong
+        * however many threads or signal handlers do it at once*/
+                site->next = __atomic_load_n(&g_log.sites, __ATOMIC_RELAXED);
+                while(!__atomic_compare_exchange_n(&g_log.sites, &site->next,
+                                site, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                        ;
+        }
+        __atomic_store_n(&g_log.suppressing, 1, __ATOMIC_RELEASE);
+        return 0;
+}
+
+/***************************************************************************
+* void logMessage(Log_Site* site, int priority, const char* format, ...)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that formats a message from a call site and queues
+*       it, unless the site is over its rate limit. The format takes the same
+*       conversions as syslog, %m included.
+*
+* Parameters:
+*        site           I/O     Log_Site*       The call site, NULL for no
+*                                               rate limit
+*        priority       I/P     int             The syslog priority
+*        format         I/P     const char*     The printf style format
+**************************************************************************/
+__attribute__((format(printf, 3, 4)))
+void logMessage(Log_Site* site, int priority, const char* format, ...)
+{
+        int saved = errno;
+        /*for %m, which reads errno when the message is formatted*/
+        char text[LOG_TEXT];
+        va_list args;
+
+        if(site != NULL && !logAllow(site)){
+                errno = saved;
+                return;
+        }
+
+        errno = saved;
+        va_start(args, format);
+        vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+
+        logPush(priority, text);
+        errno = saved;
+}
+
+/***************************************************************************
+* void logDrain(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes every published message in the ring to
+*       syslog, and reports how many were dropped while it was full. Only the
+*       log thread calls it.
+*
+* Parameters: N/A
+**************************************************************************/
+void logDrain(void)
+{
+        static uint32_t reportedDrops = 0;
+
+        while(1){
+                Log_Slot* slot = &g_log.slots[g_log.head & (LOG_SIZE - 1)];
+                if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != g_log.head + 1)
+                /*empty, or the next producer hasn't finished writing*/
+                        break;
+
+                syslog(slot->priority, "%s", slot->text);
+                __atomic_store_n(&slot->seq, g_log.head + LOG_SIZE,
+                                __ATOMIC_RELEASE);
+                /*hand the slot back to the producers, one lap on*/
+                g_log.head++;
+                __atomic_fetch_add(&g_log.written, 1, __ATOMIC_RELEASE);
+        }
+
+        uint32_t dropped = __atomic_load_n(&g_log.dropped, __ATOMIC_RELAXED);
+        if(dropped != reportedDrops){
+                syslog(LOG_WARNING, "%u log messages dropped, the log was full\n",
+                        dropped - reportedDrops);
+                reportedDrops = dropped;
+        }
+}
+
+/***************************************************************************
+* void logSweep(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reports how many messages each call site on the
+*       sweep list has held back since it was last reported, so the count of
+*       an error that stops is still logged
+*
+* Parameters: N/A
+**************************************************************************/
+void logSweep(void)
+{
+        char text[LOG_TEXT];
+
+        __atomic_store_n(&g_log.suppressing, 0, __ATOMIC_RELAXED);
+        /*cleared first, so anything held back from here on sweeps again*/
+        for(Log_Site* site = __atomic_load_n(&g_log.sites, __ATOMIC_ACQUIRE);
+                site != NULL; site = site->next){
+                uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0,
+                                                        __ATOMIC_RELAXED);
+                if(suppressed == 0)
+                        continue;
+                snprintf(text, sizeof(text),
+                        "%u messages from %s:%d were suppressed\n",
+                        suppressed, site->file, site->line);
+                logPush(LOG_NOTICE, text);
+        }
+}
+
+/***************************************************************************
+* void* logThreadMain(void* arg)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The log thread. It sleeps until a message is queued and writes
+*       out everything waiting. While messages are being held back it also
+*       wakes once every LOG_WINDOW to report them.
+*
+* Parameters:
+*        arg            I/P     void*   Unused
+*        logThreadMain  O/P     void*   Never returns
+**************************************************************************/
+void* logThreadMain(void* arg)
+{
+        struct timespec now;
+        int64_t sweptNs = 0;
+        (void)arg;
+
+        while(1){
+                if(__atomic_load_n(&g_log.suppressing, __ATOMIC_ACQUIRE)){
+                /*wake for the next sweep even if nothing else is logged*/
+                        clock_gettime(CLOCK_REALTIME, &now);
+                        now.tv_sec += LOG_WINDOW / 1000000000LL;
+                        sem_timedwait(&g_log.doorbell, &now);
+                }
+                else{
+                        while(sem_wait(&g_log.doorbell) < 0 && errno == EINTR)
+                                ;
+                }
+                logDrain();
+
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                int64_t nowNs = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+                if(__atomic_load_n(&g_log.suppressing, __ATOMIC_ACQUIRE)
+                        && nowNs - sweptNs >= LOG_WINDOW){
+                        sweptNs = nowNs;
+                        logSweep();
+                        logDrain();
+                }
+        }
+
+        return NULL;
+}
+
+/***************************************************************************
+* void logFlush(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that waits for the log thread to write out what is in
+*       the ring, for at most LOG_FLUSH_TIME, so the last messages before an
+*       exit aren't lost. It only sleeps, so a signal handler may call it.
+*
+* Parameters: N/A
+**************************************************************************/
+void logFlush(void)
+{
+        const struct timespec step = {0, 1000000};
+
+        if(!__atomic_load_n(&g_log.running, __ATOMIC_ACQUIRE)
+                || pthread_equal(pthread_self(), g_log.thread))
+                return;
+        logSweep();
+        /*report what was held back since the last sweep as well*/
+
+        for(int i = 0; i < LOG_FLUSH_TIME; i++){
+                if(__atomic_load_n(&g_log.written, __ATOMIC_ACQUIRE)
+                        == __atomic_load_n(&g_log.queued, __ATOMIC_ACQUIRE))
+                        return;
+                nanosleep(&step, NULL);
+        }
+}
+
+/***************************************************************************
+* int logStart(void)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Small stack, for locked memory
+* Description: Function that starts the log thread, after which LOGMSG only
+*       queues. It must be called after daemonising, as the thread doesn't
+*       survive a fork. The thread blocks every signal, so the handlers (which
+*       log, and wait for the log thread on exit) never run on it. The ring is
+*       flushed when the process exits.
+*
+* Parameters:
+*        logStart       O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int logStart(void)
+{
+        sigset_t all, old;
+        pthread_attr_t attr;
+
+        memset(&g_log, 0, sizeof(g_log));
+        for(uint32_t i = 0; i < LOG_SIZE; i++)
+                g_log.slots[i].seq = i;
+        if(sem_init(&g_log.doorbell, 0, 0) < 0){
+                syslog(LOG_ERR, "Failed to start the log thread: %m");
+                return 0;
+        }
+
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, LOG_STACK);
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        /*the thread inherits the mask it is started with*/
+        int err = pthread_create(&g_log.thread, &attr, logThreadMain, NULL);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        pthread_attr_destroy(&attr);
+        if(err != 0){
+                errno = err;
+                syslog(LOG_ERR, "Failed to start the log thread: %m");
+                return 0;
+        }
+
+        __atomic_store_n(&g_log.running, 1, __ATOMIC_RELEASE);
+        atexit(logFlush);
+        return 1;
+}
+
+
+#endif // LOG_H_INCLUDED
@@ -0,0 +1,77 @@
+/***************************************************************************
+* File:  Probes.h
+* Author:  SkibbleBip
+* USDT static tracepoints for bpftrace, perf and SystemTap. Every probe is in
+* the "dinger" provider and carries the sequence number the server gave the
+* lock change, and CLOCK_BOOTTIME timestamps in nanoseconds, so the latency
+* of each stage can be measured from outside the process:
+*
+*       evdev_read      (next seq, events read, read time)      server
+*       decode          (seq, status, kernel time)              server
+*       send            (seq, send time)                        server
+*       receive         (seq, kernel time, receive time)        client
+*       play_start      (seq, queued time, start time)          client
+*       pcm_write_start (seq, frames, time)                     client
+*       pcm_write_end   (seq, frames, time)                     client
+*       drain_done      (seq, time)                             client
+*
+* With <sys/sdt.h> each probe is a nop plus a semaphore check, and the
+* arguments (including the clock reads) are only evaluated while a tracer is
+* attached. Without it the probes compile to nothing.
+***************************************************************************/
+
+#ifndef PROBES_H_INCLUDED
+#define PROBES_H_INCLUDED
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define HAVE_PROBES
+#endif
+#endif
+
+
+#ifdef HAVE_PROBES
+
+#define PROBE_SEMAPHORE(name) \
+        unsigned short dinger_##name##_semaphore \
+        __attribute__((unused)) __attribute__((section(".probes")))
+/*Counts the tracers attached to a probe*/
+
+PROBE_SEMAPHORE(evdev_read);
+PROBE_SEMAPHORE(decode);
+PROBE_SEMAPHORE(send);
+PROBE_SEMAPHORE(receive);
+PROBE_SEMAPHORE(play_start);
+PROBE_SEMAPHORE(pcm_write_start);
+PROBE_SEMAPHORE(pcm_write_end);
+PROBE_SEMAPHORE(drain_done);
+
+#define PROBE_ENABLED(name) __builtin_expect(dinger_##name##_semaphore, 0)
+
+#define PROBE2(name, a, b) do{ \
+                if(PROBE_ENABLED(name)) \
+                        DTRACE_PROBE2(dinger, name, a, b); \
+        }while(0)
+#define PROBE3(name, a, b, c) do{ \
+                if(PROBE_ENABLED(name)) \
+                        DTRACE_PROBE3(dinger, name, a, b, c); \
+        }while(0)
+
+#else
+
+#define PROBE_ENABLED(name) 0
+#define PROBE2(name, a, b) do{ \
+                if(0){ (void)(a); (void)(b); } \
+        }while(0)
+#define PROBE3(name, a, b, c) do{ \
+                if(0){ (void)(a); (void)(b); (void)(c); } \
+        }while(0)
+/*the arguments are never evaluated, only referenced so they don't show up
+* as unused*/
+
+#endif
+
+
+#endif // PROBES_H_INCLUDED
@@ -0,0 +1,204 @@
+/***************************************************************************
+* File:  Realtime.h
+* Author:  SkibbleBip
+* Procedures:
+* prefaultStack         -Function that touches the top of the stack so it is
+*                               faulted in before it is needed
+* prefaultRegion        -Function that touches every page of a region of
+*                               memory so it is faulted in
+* applyRealtime         -Function that applies the opt-in real-time
+*                               scheduling and CPU pinning
+* lockMemory            -Function that applies the opt-in memory locking and
+*                               faults in the memory a ding needs
+***************************************************************************/
+
+#ifndef REALTIME_H_INCLUDED
+#define REALTIME_H_INCLUDED
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "main.h"
+
+#define         RT_PRIORITY     10
+/*Default real-time priority (DINGER_RT_PRIO)*/
+#define         STACK_PREFAULT  (64 * 1024)
+/*How much of the stack is faulted in up front*/
+
+
+int g_memoryLocked = 0;
+/*Whether lockMemory has locked the process' memory*/
+
+
+/*Struct to contain a region of memory that must not be paged out*/
+typedef struct {
+        const void* addr;
+        size_t len;
+} Memory_Region;
+
+
+/***************************************************************************
+* void prefaultStack(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes over STACK_PREFAULT bytes of stack so that
+*       those pages are already faulted in (and locked) when the event loop
+*       first needs them
+*
+* Parameters: N/A
+**************************************************************************/
+void prefaultStack(void)
+{
+        volatile unsigned char stack[STACK_PREFAULT];
+        for(size_t i = 0; i < sizeof(stack); i += 4096)
+                stack[i] = 0;
+}
+
+/***************************************************************************
+* size_t prefaultRegion(const void* addr, size_t len)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads a byte from every page of a region of
+*       memory, so that it is faulted in (and locked) before it is needed
+*
+* Parameters:
+*        addr           I/P     const void*     Start of the region
+*        len            I/P     size_t          Length of the region
+*        prefaultRegion O/P     size_t          Number of pages touched
+**************************************************************************/
+size_t prefaultRegion(const void* addr, size_t len)
+{
+        const volatile unsigned char* p = (const volatile unsigned char*)addr;
+        size_t pages = 0;
+        long pageSize = sysconf(_SC_PAGESIZE);
+
+        for(size_t i = 0; i < len; i += pageSize, pages++)
+                (void)p[i];
+        if(len > 0)
+                (void)p[len - 1];
+        /*the last page may start part way through the region*/
+
+        return pages;
+}
+
+/***************************************************************************
+* void applyRealtime(void)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Memory locking moved out to lockMemory
+* Description: Function that applies the opt-in real-time mode, so dings stay
+*       on time when the machine is saturated. Each step is configured by the
+*       environment and logs whether it took effect:
+*       DINGER_RT_POLICY fifo or rr, at priority DINGER_RT_PRIO, clamped to
+*       RLIMIT_RTPRIO when not root; DINGER_CPU pins to one CPU. Threads
+*       created afterwards inherit the scheduling and pinning. When run as root
+*       with DINGER_MLOCK, RLIMIT_MEMLOCK is lifted so lockMemory still works
+*       once root is dropped.
+*
+* Parameters: N/A
+**************************************************************************/
+void applyRealtime(void)
+{
+        const char* policyName = getenv("DINGER_RT_POLICY");
+
+        if(policyName != NULL && *policyName != '\000'){
+                int policy = -1;
+                if(0 == strcmp(policyName, "fifo"))
+                        policy = SCHED_FIFO;
+                else if(0 == strcmp(policyName, "rr"))
+                        policy = SCHED_RR;
+
+                uint priority = getConfigUInt("DINGER_RT_PRIO", RT_PRIORITY);
+                struct rlimit limit;
+                if(geteuid() != 0 && getrlimit(RLIMIT_RTPRIO, &limit) == 0
+                        && limit.rlim_cur != RLIM_INFINITY
+                        && priority > limit.rlim_cur){
+                /*unprivileged users can only go as high as RLIMIT_RTPRIO*/
+                        LOGMSG(LOG_NOTICE,
+                                "Real-time priority %u clamped to RLIMIT_RTPRIO %lu\n",
+                                priority, (unsigned long)limit.rlim_cur);
+                        priority = limit.rlim_cur;
+                }
+
+                if(policy >= 0 && priority > (uint)sched_get_priority_max(policy))
+                        priority = sched_get_priority_max(policy);
+
+                struct sched_param param;
+                param.sched_priority = priority;
+                if(policy < 0)
+                        LOGMSG(LOG_ALERT, "Unknown DINGER_RT_POLICY %s\n",
+                                policyName);
+                else if(priority == 0 || sched_setscheduler(0, policy, &param) < 0)
+                        LOGMSG(LOG_ALERT, "Failed to set %s priority %u: %m",
+                                policyName, priority);
+                else
+                        LOGMSG(LOG_NOTICE, "Running at %s priority %u\n",
+                                policyName, priority);
+        }
+
+        const char* cpuName = getenv("DINGER_CPU");
+        if(cpuName != NULL && *cpuName != '\000'){
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(atoi(cpuName), &set);
+                if(sched_setaffinity(0, sizeof(set), &set) < 0)
+                        LOGMSG(LOG_ALERT, "Failed to pin to CPU %s: %m", cpuName);
+                else
+                        LOGMSG(LOG_NOTICE, "Pinned to CPU %s\n", cpuName);
+        }
+
+        if(geteuid() == 0 && getConfigUInt("DINGER_MLOCK", 0)){
+        /*without CAP_IPC_LOCK every locked mapping counts against
+        * RLIMIT_MEMLOCK, so lift it while that is still allowed*/
+                struct rlimit unlimited = {RLIM_INFINITY, RLIM_INFINITY};
+                if(setrlimit(RLIMIT_MEMLOCK, &unlimited) < 0)
+                        LOGMSG(LOG_ALERT, "Failed to lift RLIMIT_MEMLOCK: %m");
+        }
+}
+
+/***************************************************************************
+* void lockMemory(const Memory_Region* regions, size_t count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that applies the opt-in memory locking: when
+*       DINGER_MLOCK is set, the first call locks all current and future
+*       memory, and every call faults in the given regions and the calling
+*       thread's stack. Unless the process holds CAP_IPC_LOCK, the whole
+*       address space and every mapping made afterwards count against
+*       RLIMIT_MEMLOCK, so it is best called before any threads are started
+*       and the threads kept to small stacks.
+*
+* Parameters:
+*        regions        I/P     const Memory_Region*    Memory to fault in
+*        count          I/P     size_t                  Number of regions
+**************************************************************************/
+void lockMemory(const Memory_Region* regions, size_t count)
+{
+        if(!getConfigUInt("DINGER_MLOCK", 0))
+                return;
+
+        if(!g_memoryLocked){
+                int flags = MCL_CURRENT|MCL_FUTURE;
+#ifdef MCL_ONFAULT
+                flags |= MCL_ONFAULT;
+                /*only fault pages in as they are used, rather than the whole
+                * of every thread stack and library up front*/
+#endif
+                if(mlockall(flags) < 0){
+                        LOGMSG(LOG_ALERT, "Failed to lock memory: %m");
+                        return;
+                }
+                g_memoryLocked = 1;
+        }
+
+        size_t pages = 0;
+        for(size_t i = 0; i < count; i++)
+                pages += prefaultRegion(regions[i].addr, regions[i].len);
+        prefaultStack();
+        LOGMSG(LOG_NOTICE, "Memory locked, %zu pages of sounds and %d KB "
+                "of stack faulted in\n", pages, STACK_PREFAULT / 1024);
+}
+
+
+#endif // REALTIME_H_INCLUDED
@@ -0,0 +1,609 @@
+/***************************************************************************
+* File:  EventLoop.h
+* Author:  SkibbleBip
+* Procedures:
+* decodeBatch           -Function that turns a batch of input events into the
+*                               lock change messages for the client
+* loopReport            -Function that writes the event loop statistics to
+*                               syslog
+* journalSent           -Function that records the outcome of a send in the
+*                               journal
+* sendMessages          -Function that writes a batch of messages to the client
+* epollLoop             -The classic event loop, which waits with epoll and
+*                               reads and writes with system calls
+* armRead               -Function that queues a read of the keyboard on the
+*                               io_uring instance
+* armAccept             -Function that queues a wait for a client on the
+*                               io_uring instance
+* armStop               -Function that queues a wait for the stop pipe on the
+*                               io_uring instance
+* uringLoop             -The io_uring event loop, which keeps a read posted on
+*                               the keyboard and links the client sends to it
+***************************************************************************/
+
+#ifndef EVENTLOOP_H_INCLUDED
+#define EVENTLOOP_H_INCLUDED
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <linux/input.h>
+
+#include "../main.h"
+#include "../Probes.h"
+#include "../Journal.h"
+#include "../Transport.h"
+#include "Keyboard.h"
+#include "Scan.h"
+#include "Uring.h"
+
+#define         EVENT_BATCH     64
+/*Most input events read from the keyboard at once*/
+#define         MESSAGE_BATCH   (EVENT_BATCH + TOGGLE_AXIS)
+/*Most messages sent for one batch, every LED change and one resync*/
+#define         LOOP_REPORT     1000
+/*How many wake ups there are between each statistics report*/
+#define         URING_READ      1
+#define         URING_WRITE     2
+#define         URING_ACCEPT    3
+#define         URING_STOP      4
+/*What an io_uring completion is for*/
+
+
+/*Struct to contain the counters of an event loop, to compare the two*/
+typedef struct {
+        const char* name;
+        uint wakeups;
+        /*how many times the loop woke up*/
+        uint submissions;
+        uint completions;
+        /*how many reads and writes were started and finished*/
+        uint syscalls;
+        uint events;
+        uint messages;
+} Loop_Stats;
+
+/*Struct to contain the state of the server's event loop*/
+typedef struct {
+        int in;
+        /*the keyboard event file*/
+        Channel* link;
+        /*the transport to the client*/
+        int kernelClock;
+        /*whether the kernel timestamps the events with the boot clock*/
+        int typewriter;
+        /*whether key presses are sent as clicks, and which of them
+        * (DINGER_TYPEWRITER)*/
+        uint32_t seq;
+        uint64_t batchPos;
+        /*journal position of the first lock change of the last batch*/
+        Loop_Stats stats;
+} Event_Loop;
+
+Event_Loop g_loop;
+
+
+/***************************************************************************
+* uint decodeBatch(Event_Loop* l, const struct input_event* events,
+*                       size_t count, Lock_Message* out)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that decodes a batch of input events and fills in a
+*       message for every lock change among them, and in typewriter mode for
+*       every key press. The batch is scanned for the few events that matter
+*       first, so only those are decoded. If the kernel dropped events, the
+*       current state of every lock is sent once. Only the lock changes are
+*       journaled, the clicks would push them out of it.
+*
+* Parameters:
+*        l              I/O     Event_Loop*             The event loop
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t                  Number of events, at
+*                                                       most EVENT_BATCH
+*        out            I/O     Lock_Message*           Room for MESSAGE_BATCH
+*        decodeBatch    O/P     uint                    Number of messages
+**************************************************************************/
+uint decodeBatch(Event_Loop* l, const struct input_event* events,
+                        size_t count, Lock_Message* out)
+{
+        uint32_t found[EVENT_BATCH];
+        size_t matches = scanEvents(events, count, found, l->typewriter != 0);
+        uint messages = 0;
+        int resynced = 0;
+        int journaled = 0;
+
+        for(size_t i = 0; i < matches; i++){
+                const struct input_event* event = &events[found[i]];
+                Status_t status[TOGGLE_AXIS];
+                uint decoded = 0;
+
+                if(event->type == EV_SYN){
+                /*events were dropped, so send where every lock is now. The
+                * client ignores the ones that did not change*/
+                        if(resynced || !readDeviceLeds(l->in, status))
+                                continue;
+                        resynced = 1;
+                        decoded = TOGGLE_AXIS;
+                        LOGMSG(LOG_NOTICE, "Events were dropped, resyncing the "
+                                "lock state\n");
+                }
+                else if(decodeLedEvent(*event, &status[0]))
+                        decoded = 1;
+                else if(decodeKeyEvent(*event, l->typewriter, &status[0]))
+                        decoded = 1;
+
+                for(uint j = 0; j < decoded; j++){
+                        out[messages].seq = l->seq++;
+                        out[messages].status = status[j];
+                        out[messages].kernelNs = l->kernelClock
+                                                ? getEventNs(*event)
+                                                : getBoottimeNs();
+                        PROBE3(decode, out[messages].seq, out[messages].status,
+                                out[messages].kernelNs);
+
+                        uint64_t pos;
+                        Journal_Entry* e = status[j] >= CLICK_KEY ? NULL
+                                        : journalNext(&g_journal, &pos);
+                        if(e != NULL){
+                        /*the batch takes up consecutive entries*/
+                                if(journaled++ == 0)
+                                        l->batchPos = pos;
+                                e->seq = out[messages].seq;
+                                e->status = out[messages].status;
+                                e->kernelNs = out[messages].kernelNs;
+                                e->decodeNs = getBoottimeNs();
+                        }
+                        messages++;
+                }
+        }
+
+        l->stats.events += count;
+        l->stats.messages += messages;
+        return messages;
+}
+
+/***************************************************************************
+* void loopReport(Event_Loop* l)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that writes the counters of the event loop to syslog,
+*       as averages per wake up so the backends can be compared
+*
+* Parameters:
+*        l      I/P     Event_Loop*     The event loop
+**************************************************************************/
+void loopReport(Event_Loop* l)
+{
+        double wakeups = l->stats.wakeups ? l->stats.wakeups : 1;
+
+        LOGMSG(LOG_NOTICE,
+                "%s loop: %u wakeups, %u events, %u messages, %.2f submissions, "
+                "%.2f completions and %.2f system calls per wakeup\n",
+                l->stats.name,
+                l->stats.wakeups,
+                l->stats.events,
+                l->stats.messages,
+                l->stats.submissions / wakeups,
+                l->stats.completions / wakeups,
+                l->stats.syscalls / wakeups
+                );
+}
+
+/***************************************************************************
+* void journalSent(Event_Loop* l, const Lock_Message* messages, uint count,
+*                       int sent)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that records in the journal when the lock changes of
+*       the last batch were sent, and whether the client was there to receive
+*       them. The clicks among them have no entries.
+*
+* Parameters:
+*        l              I/P     Event_Loop*             The event loop
+*        messages       I/P     const Lock_Message*     The batch
+*        count          I/P     uint                    Number of messages
+*        sent           I/P     int                     Whether it was sent
+**************************************************************************/
+void journalSent(Event_Loop* l, const Lock_Message* messages, uint count,
+                        int sent)
+{
+        int64_t now = getBoottimeNs();
+        uint64_t pos = l->batchPos;
+
+        for(uint i = 0; i < count; i++){
+                if(messages[i].status >= CLICK_KEY)
+                        continue;
+                Journal_Entry* e = journalAt(&g_journal, pos++);
+                if(e == NULL || e->seq != messages[i].seq)
+                /*no journal, or the entry was already overwritten*/
+                        return;
+                e->sendNs = now;
+                e->outcome = sent ? OUTCOME_SENT : OUTCOME_UNSENT;
+        }
+}
+
+/***************************************************************************
+* int sendMessages(Event_Loop* l, const Lock_Message* messages, uint count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sends a batch of messages to the client over
+*       the transport in use. A batch is smaller than PIPE_BUF, so the client
+*       never sees half of a message. With no client to take it, the batch is
+*       only recorded as unsent.
+*
+* Parameters:
+*        l              I/O     Event_Loop*             The event loop
+*        messages       I/P     const Lock_Message*     The messages
+*        count          I/P     uint                    Number of messages
+*        sendMessages   O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int sendMessages(Event_Loop* l, const Lock_Message* messages, uint count)
+{
+        l->stats.syscalls++;
+        l->stats.submissions++;
+        l->stats.completions++;
+
+        int sent = transportSend(l->link, messages, count);
+        if(!sent && errno != EPIPE && errno != EAGAIN){
+        /*if the write failed because the pipe is broken, or the client isn't
+        * reading the shared ring, don't do anything, just scream into the
+        * void. otherwise, display error and exit.
+        */
+                LOGMSG(LOG_ERR, "Failed to write to pipe: %m");
+                return 0;
+        }
+        journalSent(l, messages, count, sent);
+
+        if(PROBE_ENABLED(send)){
+                int64_t now = getBoottimeNs();
+                for(uint i = 0; i < count; i++)
+                        PROBE2(send, messages[i].seq, now);
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int epollLoop(Event_Loop* l)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Returns on a signal to exit
+* Description: The classic event loop. It waits for the keyboard with epoll,
+*       then reads everything waiting and sends the lock changes in one write.
+*       When the transport is a socket it also waits on it, for a client that
+*       comes back. It only returns on a failure, or when the stop pipe says
+*       a signal to exit was caught.
+*
+* Parameters:
+*        l              I/O     Event_Loop*     The event loop
+*        epollLoop      O/P     int             Always 0
+**************************************************************************/
+int epollLoop(Event_Loop* l)
+{
+        struct input_event events[EVENT_BATCH];
+        Lock_Message out[MESSAGE_BATCH];
+        struct epoll_event ev;
+
+        memset(&l->stats, 0, sizeof(l->stats));
+        l->stats.name = "epoll";
+
+        int ep = epoll_create1(EPOLL_CLOEXEC);
+        ev.events = EPOLLIN;
+        ev.data.fd = l->in;
+        if(ep < 0 || fcntl(l->in, F_SETFL, fcntl(l->in, F_GETFL) | O_NONBLOCK) < 0
+                || epoll_ctl(ep, EPOLL_CTL_ADD, l->in, &ev) < 0){
+                LOGMSG(LOG_ERR, "Failed to set up epoll: %m");
+                return 0;
+        }
+        ev.data.fd = l->link->listenFd;
+        if(l->link->listenFd >= 0
+                && epoll_ctl(ep, EPOLL_CTL_ADD, l->link->listenFd, &ev) < 0){
+        /*a client that comes back connects to the socket again*/
+                LOGMSG(LOG_ERR, "Failed to set up epoll: %m");
+                close(ep);
+                return 0;
+        }
+        ev.data.fd = g_stopPipe[0];
+        if(g_stopPipe[0] >= 0
+                && epoll_ctl(ep, EPOLL_CTL_ADD, g_stopPipe[0], &ev) < 0){
+                LOGMSG(LOG_ERR, "Failed to set up epoll: %m");
+                close(ep);
+                return 0;
+        }
+        LOGMSG(LOG_NOTICE, "Reading the keyboard with epoll\n");
+
+        while(1){
+                if(epoll_wait(ep, &ev, 1, -1) < 0){
+                /*block until the keyboard has events*/
+                        if(errno == EINTR)
+                                continue;
+                        LOGMSG(LOG_ERR, "Failed to wait for events: %m");
+                        break;
+                }
+                l->stats.wakeups++;
+                l->stats.syscalls++;
+
+                if(ev.data.fd == g_stopPipe[0])
+                /*a signal to exit, the caller shuts down*/
+                        break;
+                if(ev.data.fd == l->link->listenFd){
+                        transportAccept(l->link);
+                        continue;
+                }
+
+                ssize_t size;
+                do{
+                /*read until the keyboard has nothing left*/
+                        size = read(l->in, events, sizeof(events));
+                        l->stats.syscalls++;
+                        if(size < 0 && (errno == EAGAIN || errno == EINTR))
+                        /*epoll is level triggered, so anything left wakes
+                        * it again*/
+                                break;
+                        if(size <= 0){
+                                if(size == 0)
+                                /*the keyboard was unplugged*/
+                                        errno = ENODEV;
+                                LOGMSG(LOG_ERR, "Failed to read event file: %m");
+                                close(ep);
+                                return 0;
+                        }
+                        l->stats.submissions++;
+                        l->stats.completions++;
+                        PROBE3(evdev_read, l->seq, size / sizeof(struct input_event),
+                                getBoottimeNs());
+
+                        uint count = decodeBatch(l, events,
+                                        size / sizeof(struct input_event), out);
+                        if(count > 0 && !sendMessages(l, out, count)){
+                                close(ep);
+                                return 0;
+                        }
+                } while(size == sizeof(events));
+                /*a short read means the keyboard was drained*/
+
+                if(l->stats.wakeups % LOOP_REPORT == 0)
+                        loopReport(l);
+        }
+
+        close(ep);
+        return 0;
+}
+
+/***************************************************************************
+* int armRead(Uring* r, Event_Loop* l, struct input_event* events)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that queues a read of a batch of events from the
+*       keyboard. It is submitted with the next uringEnter.
+*
+* Parameters:
+*        r              I/O     Uring*                  The io_uring instance
+*        l              I/P     Event_Loop*             The event loop
+*        events         I/O     struct input_event*     Room for EVENT_BATCH
+*        armRead        O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int armRead(Uring* r, Event_Loop* l, struct input_event* events)
+{
+        struct io_uring_sqe* sqe = uringGetSqe(r);
+        if(sqe == NULL)
+                return 0;
+
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = l->in;
+        sqe->addr = (uint64_t)(uintptr_t)events;
+        sqe->len = EVENT_BATCH * sizeof(struct input_event);
+        sqe->off = (uint64_t)-1;
+        /*read from the current position, the keyboard is not seekable*/
+        sqe->user_data = URING_READ;
+        return 1;
+}
+
+/***************************************************************************
+* int armAccept(Uring* r, Event_Loop* l)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that queues a wait for a client connecting to the
+*       transport's socket, if it has one
+*
+* Parameters:
+*        r              I/O     Uring*          The io_uring instance
+*        l              I/P     Event_Loop*     The event loop
+*        armAccept      O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int armAccept(Uring* r, Event_Loop* l)
+{
+        if(l->link->listenFd < 0)
+                return 1;
+
+        struct io_uring_sqe* sqe = uringGetSqe(r);
+        if(sqe == NULL)
+                return 0;
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = l->link->listenFd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = URING_ACCEPT;
+        return 1;
+}
+
+/***************************************************************************
+* int armStop(Uring* r)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that queues a wait for the stop pipe, which is written
+*       to when a signal to exit is caught
+*
+* Parameters:
+*        r              I/O     Uring*          The io_uring instance
+*        armStop        O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int armStop(Uring* r)
+{
+        if(g_stopPipe[0] < 0)
+                return 1;
+
+        struct io_uring_sqe* sqe = uringGetSqe(r);
+        if(sqe == NULL)
+                return 0;
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = g_stopPipe[0];
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = URING_STOP;
+        return 1;
+}
+
+/***************************************************************************
+* int uringLoop(Event_Loop* l)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Returns on a signal to exit
+* Description: The io_uring event loop. A read is kept posted on the keyboard.
+*       When it completes, the lock changes are sent with a write, and the
+*       next read is linked behind the write so the buffers are never in use
+*       twice. Both go to the kernel with the wait for the next completion,
+*       in one system call. A transport that isn't written to (the shared
+*       ring) is sent to directly instead. It returns when the stop pipe says
+*       a signal to exit was caught, and otherwise only if io_uring is not
+*       available or fails, and the caller falls back to epollLoop.
+*
+* Parameters:
+*        l              I/O     Event_Loop*     The event loop
+*        uringLoop      O/P     int             Always 0
+**************************************************************************/
+int uringLoop(Event_Loop* l)
+{
+        struct input_event events[EVENT_BATCH];
+        Lock_Message out[MESSAGE_BATCH];
+        Uring r;
+        int running = 1;
+        uint writeCount = 0;
+        /*number of messages in the write in flight*/
+
+        memset(&l->stats, 0, sizeof(l->stats));
+        l->stats.name = "io_uring";
+
+        if(!uringInit(&r, 8))
+                return 0;
+        armRead(&r, l, events);
+        armAccept(&r, l);
+        armStop(&r);
+        LOGMSG(LOG_NOTICE, "Reading the keyboard with io_uring\n");
+
+        while(running){
+                int ret = uringEnter(&r, 1);
+                /*submit what is queued and wait for a completion*/
+                if(ret < 0){
+                        if(errno == EINTR)
+                                continue;
+                        break;
+                }
+                l->stats.wakeups++;
+                l->stats.syscalls++;
+                l->stats.submissions += ret;
+
+                struct io_uring_cqe* cqe;
+                while((cqe = uringPeekCqe(&r)) != NULL){
+                        int res = cqe->res;
+                        uint64_t what = cqe->user_data;
+                        uringCqeSeen(&r);
+                        l->stats.completions++;
+
+                        if(what == URING_STOP){
+                        /*a signal to exit, the caller shuts down*/
+                                running = 0;
+                                break;
+                        }
+                        if(what == URING_ACCEPT){
+                                transportAccept(l->link);
+                                armAccept(&r, l);
+                                continue;
+                        }
+                        if(what == URING_WRITE){
+                                journalSent(l, out,
+                                        res >= 0 ? res / sizeof(Lock_Message)
+                                                : writeCount, res >= 0);
+                                if((res == -EPIPE || res == -ECONNRESET)
+                                        && l->link->listenFd >= 0)
+                                /*the client has gone, wait for the next*/
+                                        l->link->t->drop(l->link);
+                                else if(res < 0 && res != -EPIPE){
+                                /*a broken pipe is ignored like in the epoll
+                                * loop, anything else is a failure*/
+                                        errno = -res;
+                                        LOGMSG(LOG_ERR,
+                                                "Failed to write to pipe: %m");
+                                        running = 0;
+                                        break;
+                                }
+                                continue;
+                        }
+
+                        if(res == -ECANCELED || res == -EINTR || res == -EAGAIN){
+                        /*the read was cancelled because the write before it
+                        * failed, or was interrupted, so post it again*/
+                                armRead(&r, l, events);
+                                continue;
+                        }
+                        if(res <= 0){
+                                errno = res < 0 ? -res : ENODEV;
+                                LOGMSG(LOG_ERR, "Failed to read event file: %m");
+                                running = 0;
+                                break;
+                        }
+
+                        PROBE3(evdev_read, l->seq, res / sizeof(struct input_event),
+                                getBoottimeNs());
+                        uint count = decodeBatch(l, events,
+                                        res / sizeof(struct input_event), out);
+                        if(count > 0 && (!l->link->t->writable
+                                                || l->link->fd < 0)){
+                        /*nothing to write to, so send it here*/
+                                if(!sendMessages(l, out, count)){
+                                        running = 0;
+                                        break;
+                                }
+                        }
+                        else if(count > 0){
+                                struct io_uring_sqe* sqe = uringGetSqe(&r);
+                                if(sqe == NULL){
+                                        LOGMSG(LOG_ERR, "io_uring is full\n");
+                                        running = 0;
+                                        break;
+                                }
+                                sqe->opcode = IORING_OP_WRITE;
+                                sqe->fd = l->link->fd;
+                                sqe->addr = (uint64_t)(uintptr_t)out;
+                                sqe->len = count * sizeof(Lock_Message);
+                                sqe->off = (uint64_t)-1;
+                                sqe->flags = IOSQE_IO_LINK;
+                                /*the next read waits for the write, so neither
+                                * buffer is reused while it is in flight*/
+                                sqe->user_data = URING_WRITE;
+                                writeCount = count;
+
+                                if(PROBE_ENABLED(send)){
+                                /*the send is only submitted here, it
+                                * completes with the next wake up*/
+                                        int64_t now = getBoottimeNs();
+                                        for(uint i = 0; i < count; i++)
+                                                PROBE2(send, out[i].seq, now);
+                                }
+                        }
+                        armRead(&r, l, events);
+                }
+
+                if(l->stats.wakeups % LOOP_REPORT == 0)
+                        loopReport(l);
+        }
+
+        loopReport(l);
+        uringClose(&r);
+        return 0;
+}
+
+
+#endif // EVENTLOOP_H_INCLUDED
@@ -7,6 +7,16 @@
 * cmpEventVals                   -Compares an input event struct to parameters
 *                                       of type, code and values and returns 1
 *                                       if matching and 0 if not
+* decodeLedEvent                 -Decodes an input event into the lock status
+*                                       it sets, if it is an LED event
+* decodeKeyEvent                 -Decodes a key press into the class of click
+*                                       to play for it
+* setEventClock                  -Asks the kernel to timestamp the events of a
+*                                       keyboard with the boot clock
+* getEventNs                     -Returns the timestamp of an input event in
+*                                       nanoseconds
+* readDeviceLeds                 -Reads the current state of the lock LEDs
+*                                       from the keyboard itself
 ***************************************************************************/
 
 
@@ -15,11 +25,22 @@
 
 
 #include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>//handle input events
 
 
 #include "../main.h"
 
 
+#define         HIGH    1
+#define         LOW     0
+#define         REPEAT  2
+/*value of a key event the kernel's autorepeat sends while a key is held*/
+#define         TYPEWRITER_PRESSES      1
+#define         TYPEWRITER_REPEATS      2
+/*typewriter modes (DINGER_TYPEWRITER): click for presses, or for presses
+* and autorepeats*/
+
 
 
 
@@ -47,7 +68,7 @@ int getKeyboardInputDescriptor(void)
 
         if(deviceList == NULL){
                 //fprintf(stderr, "Error, failed to read %s: %d\n",fileName, errno);
-                syslog(LOG_ERR, "Failed to read %s %m", fileName);
+                LOGMSG(LOG_ERR, "Failed to read %s %m", fileName);
                 exit(-1);
         }
         //uint c = 0;
@@ -55,28 +76,28 @@ int getKeyboardInputDescriptor(void)
                 if((result = fgets(buffer, 512, deviceList)) != NULL)
                     if(strstr(result, "keyboard")!=NULL){
 
-                        syslog(LOG_NOTICE, "Keyboard device found: %s", result);
+                        LOGMSG(LOG_NOTICE, "Keyboard device found: %s", result);
                         if(fgets(buffer, 512, deviceList) == NULL){
-                                syslog(LOG_ERR,
+                                LOGMSG(LOG_ERR,
                                         "Failed to read devices list: %m"
                                         );
                                 exit(-1);
                         }
                         if(fgets(buffer, 512, deviceList) == NULL){
-                                syslog(LOG_ERR,
+                                LOGMSG(LOG_ERR,
                                         "Failed to read devices list: %m"
                                         );
                                 exit(-1);
                         }
                         if(fgets(buffer, 512, deviceList) == NULL){
-                                syslog(LOG_ERR,
+                                LOGMSG(LOG_ERR,
                                 "Failed to read devices list: %m"
                                         );
                                 exit(-1);
                         }
                         result = fgets(buffer, 512, deviceList);
                         if(result == NULL){
-                                syslog(LOG_ERR,
+                                LOGMSG(LOG_ERR,
                                         "Failed to read devices list: %m"
                                         );
                                 exit(-1);
@@ -94,7 +115,7 @@ int getKeyboardInputDescriptor(void)
         int fd = open(full_path, O_RDONLY );
         //perror("opening");
         if(fd == -1){
-                syslog(LOG_ERR, "Error opening %s: %m", full_path);
+                LOGMSG(LOG_ERR, "Error opening %s: %m", full_path);
                 exit(-1);
         }
 
@@ -123,5 +144,160 @@ int cmpEventVals(struct input_event e, ushort t, ushort c, int v)
         return 0;
 }
 
+/***************************************************************************
+* int decodeLedEvent(struct input_event event, Status_t* status)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that checks if an input event changes one of the lock
+*        LEDs and decodes which state it is set to
+*
+* Parameters:
+*        event          I/P     struct input_event      The event to decode
+*        status         I/O     Status_t*               The decoded status
+*        decodeLedEvent O/P     int     Bool return of whether the event is a
+*                                       lock LED change
+**************************************************************************/
+int decodeLedEvent(struct input_event event, Status_t* status)
+{
+        /*check if the event mathces one of the states where an LED
+        *changes
+        */
+        if(cmpEventVals(event, EV_LED, LED_CAPSL, HIGH)){
+                *status = CAPS_ON;
+        }
+        else if(cmpEventVals(event, EV_LED, LED_CAPSL, LOW)){
+                *status = CAPS_OFF;
+        }
+        else if(cmpEventVals(event, EV_LED, LED_NUML, HIGH)){
+                *status = NUM_ON;
+        }
+        else if(cmpEventVals(event, EV_LED, LED_NUML, LOW)){
+                *status = NUM_OFF;
+        }
+        else if(cmpEventVals(event, EV_LED, LED_SCROLLL, HIGH)){
+                *status = SCROLL_ON;
+        }
+        else if(cmpEventVals(event, EV_LED, LED_SCROLLL, LOW)){
+                *status = SCROLL_OFF;
+        }
+        else{
+        /*if no LED state is detected, then there is nothing to report*/
+                return 0;
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int decodeKeyEvent(struct input_event event, int mode, Status_t* status)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that checks if an input event is a key press to click
+*        for in typewriter mode, and decodes which class of click it gets.
+*        Releases are ignored, as are mouse and joystick buttons, which are
+*        key events too.
+*
+* Parameters:
+*        event          I/P     struct input_event      The event to decode
+*        mode           I/P     int                     The typewriter mode
+*        status         I/O     Status_t*               The click to play
+*        decodeKeyEvent O/P     int     Bool return of whether to click
+**************************************************************************/
+int decodeKeyEvent(struct input_event event, int mode, Status_t* status)
+{
+        if(event.type != EV_KEY || event.code >= BTN_MISC
+                || (event.value != HIGH
+                        && !(event.value == REPEAT && mode >= TYPEWRITER_REPEATS)))
+                return 0;
+
+        switch(event.code){
+        case KEY_SPACE:
+                *status = CLICK_SPACE;
+                break;
+        case KEY_ENTER:
+        case KEY_KPENTER:
+                *status = CLICK_ENTER;
+                break;
+        case KEY_BACKSPACE:
+        case KEY_DELETE:
+                *status = CLICK_ERASE;
+                break;
+        default:
+                *status = CLICK_KEY;
+                break;
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int setEventClock(int fd)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that asks the kernel to timestamp the events of the
+*        keyboard with CLOCK_BOOTTIME rather than the wall clock, so the age
+*        of an event can be measured across a suspend or a clock change
+*
+* Parameters:
+*        fd             I/P     int     The keyboard event file descriptor
+*        setEventClock  O/P     int     Bool return of whether the kernel
+*                                       stamps events with the boot clock
+**************************************************************************/
+int setEventClock(int fd)
+{
+        int clock = CLOCK_BOOTTIME;
+        if(ioctl(fd, EVIOCSCLOCKID, &clock) < 0){
+                LOGMSG(LOG_ALERT, "Failed to set the event clock, "
+                        "timestamping events on read instead: %m");
+                return 0;
+        }
+        return 1;
+}
+
+/***************************************************************************
+* int64_t getEventNs(struct input_event event)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the timestamp the kernel gave an event
+*
+* Parameters:
+*        event          I/P     struct input_event      The event
+*        getEventNs     O/P     int64_t The timestamp in nanoseconds
+**************************************************************************/
+int64_t getEventNs(struct input_event event)
+{
+        return (int64_t)event.input_event_sec * 1000000000LL
+                + (int64_t)event.input_event_usec * 1000;
+}
+
+/***************************************************************************
+* int readDeviceLeds(int fd, Status_t* status)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads the current state of the lock LEDs from the
+*        keyboard. After a SYN_DROPPED the LED events in between are lost, so
+*        this is how the server finds out where the locks ended up.
+*
+* Parameters:
+*        fd             I/P     int             The keyboard event file
+*        status         I/O     Status_t*       The state of each lock, in
+*                                               TOGGLE_AXIS order
+*        readDeviceLeds O/P     int     Bool return of whether the LEDs could
+*                                       be read
+**************************************************************************/
+int readDeviceLeds(int fd, Status_t* status)
+{
+        const int leds[TOGGLE_AXIS] = {LED_CAPSL, LED_NUML, LED_SCROLLL};
+        /*the LED of each lock, in the same order as Status_t*/
+        unsigned char bits[LED_MAX / 8 + 1];
+
+        memset(bits, 0, sizeof(bits));
+        if(ioctl(fd, EVIOCGLED(sizeof(bits)), bits) < 0)
+                return 0;
+
+        for(int i = 0; i < TOGGLE_AXIS; i++){
+                int on = bits[leds[i] / 8] & (1 << (leds[i] % 8));
+                status[i] = on ? (Status_t)i : (Status_t)(i + TOGGLE_AXIS);
+        }
+        return 1;
+}
 
 #endif // KEYBOARD_H_INCLUDED
@@ -0,0 +1,293 @@
+/***************************************************************************
+* File:  Leds.h
+* Author:  SkibbleBip
+* Procedures:
+* ledWatchInit          -Function that opens the brightness files of every
+*                               lock LED in the LED class
+* ledWatchRead          -Function that reads the state of one lock from its
+*                               open brightness files
+* ledWatchClose         -Function that closes the brightness files
+* ledLoop               -The sysfs LED event loop, which sends the lock changes
+*                               without reading the keyboard at all
+***************************************************************************/
+
+#ifndef LEDS_H_INCLUDED
+#define LEDS_H_INCLUDED
+
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+
+#include "../main.h"
+#include "EventLoop.h"
+
+#define         MAX_LED_FILES   16
+/*Most lock LEDs watched, there are up to three for every keyboard*/
+#define         LED_POLL_TIME   50
+/*Default time in milliseconds between reads of LEDs that can't notify
+* (DINGER_LED_POLL_MS)*/
+
+
+/*Struct to contain one lock LED of one keyboard*/
+typedef struct {
+        int lock;
+        /*which lock it is, in TOGGLE_AXIS order*/
+        int brightness;
+        /*the brightness file, read for the state*/
+        int notify;
+        /*the brightness_hw_changed file, which poll() wakes on, or -1*/
+} Led_File;
+
+/*Struct to contain every lock LED being watched*/
+typedef struct {
+        Led_File files[MAX_LED_FILES];
+        uint count;
+        uint notifying;
+        /*how many of the files can notify*/
+        int state[TOGGLE_AXIS];
+        /*last state sent for each lock, -1 if unknown*/
+} Led_Watch;
+
+
+/***************************************************************************
+* int ledWatchInit(Led_Watch* w)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that finds every lock LED in the LED class, ie
+*       /sys/class/leds/input3::capslock, and opens its brightness file, and
+*       its brightness_hw_changed file if the driver has one
+*
+* Parameters:
+*        w              I/O     Led_Watch*      The watch to set up
+*        ledWatchInit   O/P     int     Bool-type return value of whether any
+*                                       lock LED was found
+**************************************************************************/
+int ledWatchInit(Led_Watch* w)
+{
+        DIR* dir = opendir(LED_CLASS_DIR);
+        struct dirent* entry;
+
+        memset(w, 0, sizeof(*w));
+        for(int i = 0; i < TOGGLE_AXIS; i++)
+                w->state[i] = -1;
+
+        if(dir == NULL)
+                return 0;
+
+        while((entry = readdir(dir)) != NULL && w->count < MAX_LED_FILES){
+                size_t len = strlen(entry->d_name);
+                for(int lock = 0; lock < TOGGLE_AXIS; lock++){
+                        char suffix[32];
+                        snprintf(suffix, sizeof(suffix), "::%s", g_ledNames[lock]);
+                        size_t sLen = strlen(suffix);
+                        if(len < sLen
+                                || strcmp(entry->d_name + len - sLen, suffix) != 0)
+                        /*not a lock LED*/
+                                continue;
+
+                        char path[300];
+                        Led_File* f = &w->files[w->count];
+                        snprintf(path, sizeof(path), "%s/%s/brightness",
+                                LED_CLASS_DIR, entry->d_name);
+                        f->brightness = open(path, O_RDONLY|O_CLOEXEC);
+                        if(f->brightness < 0)
+                                break;
+
+                        snprintf(path, sizeof(path), "%s/%s/brightness_hw_changed",
+                                LED_CLASS_DIR, entry->d_name);
+                        f->notify = open(path, O_RDONLY|O_CLOEXEC);
+                        if(f->notify >= 0)
+                                w->notifying++;
+                        f->lock = lock;
+                        w->count++;
+                        break;
+                }
+        }
+        closedir(dir);
+
+        LOGMSG(LOG_NOTICE, "Watching %u lock LEDs, %u of which can notify\n",
+                w->count, w->notifying);
+        return w->count > 0;
+}
+
+/***************************************************************************
+* int ledWatchRead(Led_Watch* w, int lock, uint* reads)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads the state of a lock from its open
+*       brightness files. If there are several keyboards, the lock is on if
+*       any of their LEDs is.
+*
+* Parameters:
+*        w              I/O     Led_Watch*      The watch
+*        lock           I/P     int             The lock to read
+*        reads          I/O     uint*           Counts the files read
+*        ledWatchRead   O/P     int     1 if on, 0 if off and -1 if none of
+*                                       its files could be read
+**************************************************************************/
+int ledWatchRead(Led_Watch* w, int lock, uint* reads)
+{
+        int state = -1;
+
+        for(uint i = 0; i < w->count; i++){
+                Led_File* f = &w->files[i];
+                char value[16];
+                if(f->lock != lock)
+                        continue;
+
+                if(f->notify >= 0)
+                /*reading the notifying file re-arms its poll()*/
+                        (void)pread(f->notify, value, sizeof(value), 0);
+                ssize_t n = pread(f->brightness, value, sizeof(value) - 1, 0);
+                (*reads)++;
+                if(n <= 0)
+                        continue;
+                value[n] = '\000';
+
+                if(state < 1)
+                        state = atoi(value) > 0;
+        }
+
+        return state;
+}
+
+/***************************************************************************
+* void ledWatchClose(Led_Watch* w)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes every file of the watch
+*
+* Parameters:
+*        w      I/O     Led_Watch*      The watch
+**************************************************************************/
+void ledWatchClose(Led_Watch* w)
+{
+        for(uint i = 0; i < w->count; i++){
+                close(w->files[i].brightness);
+                if(w->files[i].notify >= 0)
+                        close(w->files[i].notify);
+        }
+        w->count = 0;
+}
+
+/***************************************************************************
+* int ledLoop(Event_Loop* l, Led_Watch* w)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Returns on a signal to exit
+* Description: The sysfs LED event loop. Instead of reading every keystroke
+*       from the keyboard, it only looks at the lock LEDs, and sends a
+*       message when one changes. The keyboard LED driver does not notify
+*       changes to brightness, so unless every LED has a brightness_hw_changed
+*       file the LEDs are read every DINGER_LED_POLL_MS. Either way it wakes
+*       up far less often than the evdev loop on a busy keyboard, which the
+*       statistics show. It only returns on a failure, or when the stop pipe
+*       says a signal to exit was caught.
+*
+* Parameters:
+*        l              I/O     Event_Loop*     The event loop
+*        w              I/O     Led_Watch*      The lock LEDs to watch
+*        ledLoop        O/P     int             Always 0
+**************************************************************************/
+int ledLoop(Event_Loop* l, Led_Watch* w)
+{
+        struct pollfd fds[MAX_LED_FILES + 2];
+        uint nfds = 0;
+        int timeout = -1;
+
+        memset(&l->stats, 0, sizeof(l->stats));
+        l->stats.name = "sysfs LED";
+
+        for(uint i = 0; i < w->count; i++){
+                if(w->files[i].notify < 0)
+                        continue;
+                fds[nfds].fd = w->files[i].notify;
+                fds[nfds].events = POLLPRI|POLLERR;
+                fds[nfds++].revents = 0;
+        }
+        uint stop = nfds;
+        fds[nfds].fd = g_stopPipe[0];
+        fds[nfds].events = POLLIN;
+        fds[nfds++].revents = 0;
+        /*poll skips it if there is no stop pipe*/
+        if(l->link->listenFd >= 0){
+        /*a client that comes back connects to the socket again*/
+                fds[nfds].fd = l->link->listenFd;
+                fds[nfds].events = POLLIN;
+                fds[nfds++].revents = 0;
+        }
+        if(w->notifying < w->count){
+        /*some LEDs can't tell us when they change, so read them on a timer*/
+                timeout = getConfigUInt("DINGER_LED_POLL_MS", LED_POLL_TIME);
+                LOGMSG(LOG_NOTICE, "Reading the lock LEDs every %d ms\n",
+                        timeout);
+        }
+
+        for(int lock = 0; lock < TOGGLE_AXIS; lock++){
+        /*start from the current state, so nothing is sent for it*/
+                uint reads = 0;
+                w->state[lock] = ledWatchRead(w, lock, &reads);
+        }
+
+        while(1){
+                if(poll(fds, nfds, timeout) < 0){
+                        if(errno == EINTR)
+                                continue;
+                        LOGMSG(LOG_ERR, "Failed to wait for the LEDs: %m");
+                        return 0;
+                }
+                l->stats.wakeups++;
+                l->stats.syscalls++;
+                if(fds[stop].revents & POLLIN)
+                /*a signal to exit, the caller shuts down*/
+                        return 0;
+                if(l->link->listenFd >= 0 && (fds[nfds - 1].revents & POLLIN))
+                        transportAccept(l->link);
+
+                Lock_Message out[TOGGLE_AXIS];
+                uint count = 0;
+                uint reads = 0;
+                for(int lock = 0; lock < TOGGLE_AXIS; lock++){
+                        int on = ledWatchRead(w, lock, &reads);
+                        if(on < 0 || on == w->state[lock])
+                                continue;
+                        w->state[lock] = on;
+
+                        out[count].seq = l->seq++;
+                        out[count].status = on ? (Status_t)lock
+                                                : (Status_t)(lock + TOGGLE_AXIS);
+                        out[count].kernelNs = getBoottimeNs();
+                        /*sysfs has no timestamp, so this is when it was seen*/
+                        PROBE3(decode, out[count].seq, out[count].status,
+                                out[count].kernelNs);
+
+                        uint64_t pos;
+                        Journal_Entry* e = journalNext(&g_journal, &pos);
+                        if(e != NULL){
+                                if(count == 0)
+                                        l->batchPos = pos;
+                                e->seq = out[count].seq;
+                                e->status = out[count].status;
+                                e->kernelNs = out[count].kernelNs;
+                                e->decodeNs = e->kernelNs;
+                        }
+                        count++;
+                }
+                l->stats.syscalls += reads;
+                l->stats.submissions += reads;
+                l->stats.completions += reads;
+                l->stats.events += reads;
+                l->stats.messages += count;
+
+                if(count > 0 && !sendMessages(l, out, count))
+                        return 0;
+
+                if(l->stats.wakeups % LOOP_REPORT == 0)
+                        loopReport(l);
+        }
+
+        return 0;
+}
+
+
+#endif // LEDS_H_INCLUDED
@@ -0,0 +1,234 @@
+/***************************************************************************
+* File:  Scan.h
+* Author:  SkibbleBip
+* Procedures:
+* isScanMatch           -Function that checks if one input event is an LED
+*                               change, a SYN_DROPPED or, if wanted, a key
+* scanEventsScalar      -Function that finds the LED and SYN_DROPPED events in
+*                               a buffer one event at a time
+* scanEventsSse2        -Function that finds the LED and SYN_DROPPED events in
+*                               a buffer four events at a time
+* scanEventsAvx2        -Function that finds the LED and SYN_DROPPED events in
+*                               a buffer eight events at a time
+* scanEvents            -Function that finds the LED and SYN_DROPPED events in
+*                               a buffer with the widest scanner built in
+***************************************************************************/
+
+#ifndef SCAN_H_INCLUDED
+#define SCAN_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/input.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "../main.h"
+
+#define         SCAN_DROPPED    ((uint32_t)SYN_DROPPED << 16 | EV_SYN)
+/*The type and code of a SYN_DROPPED event read as one 32 bit word*/
+
+_Static_assert(offsetof(struct input_event, type) % 4 == 0
+                && offsetof(struct input_event, code) == offsetof(struct input_event, type) + 2
+                && sizeof(struct input_event) % 4 == 0,
+                "the scanners read the type and code of an event as one word");
+
+
+/***************************************************************************
+* int isScanMatch(const struct input_event* event)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that checks if an input event is one the decoder needs
+*       to see, ie an LED change or a SYN_DROPPED, and in typewriter mode a
+*       key
+*
+* Parameters:
+*        event          I/P     const struct input_event*       The event
+*        keys           I/P     int     Whether key events are wanted
+*        isScanMatch    O/P     int     Bool return of whether it matches
+**************************************************************************/
+int isScanMatch(const struct input_event* event, int keys)
+{
+        return event->type == EV_LED
+                || (event->type == EV_SYN && event->code == SYN_DROPPED)
+                || (keys && event->type == EV_KEY);
+}
+
+/***************************************************************************
+* size_t scanEventsScalar(const struct input_event* events, size_t count,
+*                               uint32_t* found, int keys)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that finds the LED and SYN_DROPPED events in a buffer,
+*       checking one event at a time
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t          Number of events
+*        found          I/O     uint32_t*       Room for count indices
+*        keys           I/P     int             Whether key events are wanted
+*        scanEventsScalar       O/P     size_t  Number of events found
+**************************************************************************/
+size_t scanEventsScalar(const struct input_event* events, size_t count,
+                                uint32_t* found, int keys)
+{
+        size_t n = 0;
+
+        for(size_t i = 0; i < count; i++){
+                if(isScanMatch(&events[i], keys))
+                        found[n++] = i;
+        }
+        return n;
+}
+
+#ifdef __SSE2__
+/***************************************************************************
+* size_t scanEventsSse2(const struct input_event* events, size_t count,
+*                               uint32_t* found, int keys)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that finds the LED and SYN_DROPPED events in a buffer.
+*       The type and code words of four events are packed into one vector and
+*       compared at once, so the common case of four keyboard events with
+*       nothing to report costs a single branch.
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t          Number of events
+*        found          I/O     uint32_t*       Room for count indices
+*        keys           I/P     int             Whether key events are wanted
+*        scanEventsSse2 O/P     size_t          Number of events found
+**************************************************************************/
+size_t scanEventsSse2(const struct input_event* events, size_t count,
+                                uint32_t* found, int keys)
+{
+        const __m128i typeMask = _mm_set1_epi32(0xffff);
+        const __m128i led = _mm_set1_epi32(EV_LED);
+        const __m128i key = _mm_set1_epi32(keys ? EV_KEY : EV_LED);
+        /*without keys it only matches the LEDs again*/
+        const __m128i dropped = _mm_set1_epi32(SCAN_DROPPED);
+        size_t n = 0;
+        size_t i = 0;
+
+        for(; i + 4 <= count; i += 4){
+                __m128i e0 = _mm_loadl_epi64((const __m128i*)&events[i].type);
+                __m128i e1 = _mm_loadl_epi64((const __m128i*)&events[i+1].type);
+                __m128i e2 = _mm_loadl_epi64((const __m128i*)&events[i+2].type);
+                __m128i e3 = _mm_loadl_epi64((const __m128i*)&events[i+3].type);
+                /*the type, code and value of each event*/
+                __m128i v = _mm_unpacklo_epi64(_mm_unpacklo_epi32(e0, e1),
+                                                _mm_unpacklo_epi32(e2, e3));
+                /*keep only the type and code words, one per lane*/
+                __m128i type = _mm_and_si128(v, typeMask);
+                __m128i hit = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi32(type, led),
+                                        _mm_cmpeq_epi32(type, key)),
+                        _mm_cmpeq_epi32(v, dropped));
+                int mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+
+                while(mask != 0){
+                /*one bit per matching event*/
+                        found[n++] = i + __builtin_ctz(mask);
+                        mask &= mask - 1;
+                }
+        }
+
+        size_t tail = scanEventsScalar(events + i, count - i, found + n, keys);
+        for(size_t j = 0; j < tail; j++)
+        /*the tail was scanned from i, so move its indices along*/
+                found[n + j] += i;
+
+        return n + tail;
+}
+#endif
+
+#ifdef __AVX2__
+/***************************************************************************
+* size_t scanEventsAvx2(const struct input_event* events, size_t count,
+*                               uint32_t* found, int keys)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that finds the LED and SYN_DROPPED events in a buffer,
+*       gathering the type and code words of eight events into one vector
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t          Number of events
+*        found          I/O     uint32_t*       Room for count indices
+*        keys           I/P     int             Whether key events are wanted
+*        scanEventsAvx2 O/P     size_t          Number of events found
+**************************************************************************/
+size_t scanEventsAvx2(const struct input_event* events, size_t count,
+                                uint32_t* found, int keys)
+{
+        const int stride = sizeof(struct input_event) / sizeof(int32_t);
+        const __m256i index = _mm256_setr_epi32(0, stride, 2*stride, 3*stride,
+                                        4*stride, 5*stride, 6*stride, 7*stride);
+        const __m256i typeMask = _mm256_set1_epi32(0xffff);
+        const __m256i led = _mm256_set1_epi32(EV_LED);
+        const __m256i key = _mm256_set1_epi32(keys ? EV_KEY : EV_LED);
+        const __m256i dropped = _mm256_set1_epi32(SCAN_DROPPED);
+        size_t n = 0;
+        size_t i = 0;
+
+        for(; i + 8 <= count; i += 8){
+                __m256i v = _mm256_i32gather_epi32((const int*)&events[i].type,
+                                                index, 4);
+                __m256i type = _mm256_and_si256(v, typeMask);
+                __m256i hit = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi32(type, led),
+                                        _mm256_cmpeq_epi32(type, key)),
+                        _mm256_cmpeq_epi32(v, dropped));
+                int mask = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+
+                while(mask != 0){
+                        found[n++] = i + __builtin_ctz(mask);
+                        mask &= mask - 1;
+                }
+        }
+
+        size_t tail = scanEventsScalar(events + i, count - i, found + n, keys);
+        for(size_t j = 0; j < tail; j++)
+        /*the tail was scanned from i, so move its indices along*/
+                found[n + j] += i;
+
+        return n + tail;
+}
+#endif
+
+/***************************************************************************
+* size_t scanEvents(const struct input_event* events, size_t count,
+*                       uint32_t* found, int keys)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that finds the LED and SYN_DROPPED events in a buffer
+*       of input events, and the key events if asked, and stores their
+*       indices, in order, using the widest scanner the server was built
+*       with. Only those events need decoding.
+*
+* Parameters:
+*        events         I/P     const struct input_event*       The events
+*        count          I/P     size_t          Number of events
+*        found          I/O     uint32_t*       Room for count indices
+*        keys           I/P     int             Whether key events are wanted
+*        scanEvents     O/P     size_t          Number of events found
+**************************************************************************/
+size_t scanEvents(const struct input_event* events, size_t count,
+                        uint32_t* found, int keys)
+{
+#if defined(__AVX2__)
+        return scanEventsAvx2(events, count, found, keys);
+#elif defined(__SSE2__)
+        return scanEventsSse2(events, count, found, keys);
+#else
+        return scanEventsScalar(events, count, found, keys);
+#endif
+}
+
+
+#endif // SCAN_H_INCLUDED
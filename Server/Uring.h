@@ -0,0 +1,228 @@
+/***************************************************************************
+* File:  Uring.h
+* Author:  SkibbleBip
+* Procedures:
+* uringInit             -Function that sets up an io_uring instance and maps
+*                               its rings
+* uringGetSqe           -Function that returns the next free submission entry
+* uringEnter            -Function that submits the queued entries and waits
+*                               for completions
+* uringPeekCqe          -Function that returns the next completion, if any
+* uringCqeSeen          -Function that hands a completion back to the kernel
+* uringClose            -Function that unmaps and closes the io_uring instance
+***************************************************************************/
+
+#ifndef URING_H_INCLUDED
+#define URING_H_INCLUDED
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "../main.h"
+
+
+/*Struct to contain an io_uring instance and its mapped rings. This uses the
+* raw system calls rather than liburing, so the server has no new dependency*/
+typedef struct {
+        int fd;
+        unsigned *sqHead;
+        unsigned *sqTail;
+        unsigned *sqMask;
+        unsigned *sqArray;
+        struct io_uring_sqe* sqes;
+        unsigned *cqHead;
+        unsigned *cqTail;
+        unsigned *cqMask;
+        struct io_uring_cqe* cqes;
+
+        void* sqRing;
+        size_t sqRingSize;
+        void* cqRing;
+        size_t cqRingSize;
+        size_t sqesSize;
+        /*the mappings, to unmap them on closing*/
+        unsigned pending;
+        /*entries queued since the last submission*/
+} Uring;
+
+void uringClose(Uring* r);
+
+
+/***************************************************************************
+* int uringInit(Uring* r, unsigned entries)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sets up an io_uring instance with room for the
+*       given number of entries and maps its submission and completion rings
+*
+* Parameters:
+*        r              I/O     Uring*          The instance to set up
+*        entries        I/P     unsigned        Size of the submission ring
+*        uringInit      O/P     int             Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int uringInit(Uring* r, unsigned entries)
+{
+        struct io_uring_params p;
+
+        memset(r, 0, sizeof(*r));
+        memset(&p, 0, sizeof(p));
+
+        r->fd = syscall(__NR_io_uring_setup, entries, &p);
+        if(r->fd < 0)
+                return 0;
+
+        r->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        r->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+
+        r->sqRing = mmap(NULL, r->sqRingSize, PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+        r->cqRing = mmap(NULL, r->cqRingSize, PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        r->sqes = mmap(NULL, r->sqesSize, PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES);
+        if(r->sqRing == MAP_FAILED || r->cqRing == MAP_FAILED
+                || r->sqes == MAP_FAILED){
+                int err = errno;
+                if(r->sqRing == MAP_FAILED)
+                        r->sqRing = NULL;
+                if(r->cqRing == MAP_FAILED)
+                        r->cqRing = NULL;
+                if(r->sqes == MAP_FAILED)
+                        r->sqes = NULL;
+                uringClose(r);
+                errno = err;
+                return 0;
+        }
+
+        char* sq = (char*)r->sqRing;
+        char* cq = (char*)r->cqRing;
+        r->sqHead = (unsigned*)(sq + p.sq_off.head);
+        r->sqTail = (unsigned*)(sq + p.sq_off.tail);
+        r->sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+        r->sqArray = (unsigned*)(sq + p.sq_off.array);
+        r->cqHead = (unsigned*)(cq + p.cq_off.head);
+        r->cqTail = (unsigned*)(cq + p.cq_off.tail);
+        r->cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+        r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+        return 1;
+}
+
+/***************************************************************************
+* struct io_uring_sqe* uringGetSqe(Uring* r)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the next free submission entry, cleared,
+*       or NULL if the ring is full. The entry is handed to the kernel by the
+*       next uringEnter.
+*
+* Parameters:
+*        r              I/O     Uring*                  The instance
+*        uringGetSqe    O/P     struct io_uring_sqe*    The entry to fill in
+**************************************************************************/
+struct io_uring_sqe* uringGetSqe(Uring* r)
+{
+        unsigned tail = *r->sqTail;
+        unsigned head = __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+
+        if(tail - head > *r->sqMask)
+                return NULL;
+
+        unsigned index = tail & *r->sqMask;
+        struct io_uring_sqe* sqe = &r->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        r->sqArray[index] = index;
+        __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+        /*publishing the tail before the entry is filled in is safe, the kernel
+        * only reads the ring when it is entered*/
+        r->pending++;
+
+        return sqe;
+}
+
+/***************************************************************************
+* int uringEnter(Uring* r, unsigned wait)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that submits every queued entry and waits until at
+*       least the given number of completions are ready, in one system call
+*
+* Parameters:
+*        r              I/O     Uring*          The instance
+*        wait           I/P     unsigned        Completions to wait for
+*        uringEnter     O/P     int             Number of entries submitted,
+*                                               or -1 on failure
+**************************************************************************/
+int uringEnter(Uring* r, unsigned wait)
+{
+        int ret = syscall(__NR_io_uring_enter, r->fd, r->pending, wait,
+                        wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if(ret >= 0)
+                r->pending -= ret;
+        return ret;
+}
+
+/***************************************************************************
+* struct io_uring_cqe* uringPeekCqe(Uring* r)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the oldest completion without waiting,
+*       or NULL if there is none
+*
+* Parameters:
+*        r              I/O     Uring*                  The instance
+*        uringPeekCqe   O/P     struct io_uring_cqe*    The completion
+**************************************************************************/
+struct io_uring_cqe* uringPeekCqe(Uring* r)
+{
+        unsigned head = *r->cqHead;
+
+        if(head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE))
+                return NULL;
+        return &r->cqes[head & *r->cqMask];
+}
+
+/***************************************************************************
+* void uringCqeSeen(Uring* r)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that hands the oldest completion back to the kernel
+*       once it has been handled
+*
+* Parameters:
+*        r      I/O     Uring*  The instance
+**************************************************************************/
+void uringCqeSeen(Uring* r)
+{
+        __atomic_store_n(r->cqHead, *r->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+/***************************************************************************
+* void uringClose(Uring* r)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that unmaps the rings and closes the instance, which
+*       cancels anything still in flight
+*
+* Parameters:
+*        r      I/O     Uring*  The instance
+**************************************************************************/
+void uringClose(Uring* r)
+{
+        if(r->sqes != NULL)
+                munmap(r->sqes, r->sqesSize);
+        if(r->cqRing != NULL)
+                munmap(r->cqRing, r->cqRingSize);
+        if(r->sqRing != NULL)
+                munmap(r->sqRing, r->sqRingSize);
+        if(r->fd >= 0)
+                close(r->fd);
+        memset(r, 0, sizeof(*r));
+        r->fd = -1;
+}
+
+
+#endif // URING_H_INCLUDED
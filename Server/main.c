@@ -5,31 +5,36 @@
 * failedShutdown        -Handle to complete closing any open pipes and files
 *                               and cleanly eit with status -1 on occurance of
 *                               an error
-* shutdown              -Signal handler to process the shutdown procedures
+* shutdownDaemon        -Function that processes the shutdown procedures once
+*                               a signal to exit was caught
 * main                  -The main function
 ***************************************************************************/
 
 
+#define _GNU_SOURCE
+/*for the CPU affinity calls in Realtime.h*/
+
 #include <unistd.h>
 #include <string.h>
 #include <sys/file.h>
 #include <linux/input.h>//handle input events
 #include <linux/input-event-codes.h> //event codes
 #include <sys/stat.h>
+#include <grp.h>
 
 
 #include "Keyboard.h"
+#include "EventLoop.h"
+#include "Leds.h"
 #include "../main.h"
-
-
-#define         HIGH    1
-#define         LOW     0
+#include "../Realtime.h"
+#include "../Transport.h"
 
 
 /*Global variables to handles and parameters*/
-int g_pipeLocation;
-/*client-server pipe*/
-int g_fd;
+Channel g_channel;
+/*client-server transport*/
+int g_fd = -1;
 /*keyboard file descriptor*/
 int g_pidfile;
 /*PID file location*/
@@ -47,44 +52,51 @@ int g_pidfile;
 **************************************************************************/
 void failedShutdown(void)
 {
-        close(g_pipeLocation);
+        unlink(CAPS_FILE_DESC);
+        /*Unlink the caps file pipe before closing it, so a reconnecting client
+        * never opens the old pipe*/
+        transportClose(&g_channel);
         close(g_pidfile);
         close(g_fd);
         /*close all the open files (the pid file is unlocked on closing)*/
-        unlink(CAPS_FILE_DESC);
-        /*Unlink the caps file pipe*/
 
         if(remove("/var/run/CapsLockServer.pid") != 0){
         /*remove the PID file*/
-                syslog(LOG_ERR, "Failed to remove PID file: %m");
+                LOGMSG(LOG_ERR, "Failed to remove PID file: %m");
         }
 
         exit(-1);
 }
 /***************************************************************************
-* void shutdown(int sig)
+* void shutdownDaemon(int sig)
 * Author: SkibbleBip
-* Date: 05/27/2021
-* Description: Signal handler to process the shutdown procedures
+* Date: 05/27/2021      v1: Initial
+* Date: 10/19/2026      v2: Called from the main loop instead of the handler
+* Description: Function that processes the shutdown procedures once
+*       stopHandler has caught a signal to exit. It runs on the main thread,
+*       outside the handler, so it can log and exit safely.
 *
 * Parameters:
 *        sig    I/P     int     Signal value
 **************************************************************************/
-void shutdown(int sig)
+void shutdownDaemon(int sig)
 {
-        syslog(LOG_NOTICE, "Received signal %d to exit\n", sig);
-        close(g_pipeLocation);
+        LOGMSG(LOG_NOTICE, "Received signal %d to exit\n", sig);
+        if(g_loop.stats.name != NULL)
+                loopReport(&g_loop);
+        unlink(CAPS_FILE_DESC);
+        /*Unlink the caps file pipe before closing it, so a reconnecting client
+        * never opens the old pipe*/
+        transportClose(&g_channel);
         close(g_pidfile);
         close(g_fd);
         /*close all the open files (the pid file is unlocked on closing)*/
 
-        /*Unlink the caps file pipe*/
-        unlink(CAPS_FILE_DESC);
         if(remove("/var/run/CapsLockServer.pid") != 0){
-                syslog(LOG_ERR, "Failed to remove PID file: %m");
+                LOGMSG(LOG_ERR, "Failed to remove PID file: %m");
         }
 
-	syslog(LOG_NOTICE, "Closed. Goodbye!");
+	LOGMSG(LOG_NOTICE, "Closed. Goodbye!");
 	exit(0);
 
 }
@@ -105,69 +117,32 @@ int main(void)
 
         if(getuid() != 0){
                 printf("Must be run as root\n");
-                syslog(LOG_ERR, "Must be run as root\n");
+                LOGMSG(LOG_ERR, "Must be run as root\n");
                 exit(0);
         }
 
 
-        pid_t pid = fork();
-        /*Fork the first time*/
-        if(pid < 0){
-                syslog(LOG_ERR, "Failed to fork: %m");
-                exit(-1);
-                /*If there was a problem forking, then display error and exit*/
-        }
-        if(pid>0){
-                syslog(LOG_NOTICE, "Successfully forked daemon\n");
-                exit(0);
-                /*sucessfully forked, we can now cleanly exit*/
-        }
-        if(setsid() <0){
-                /*Otherwise, display error and exit*/
-                syslog(LOG_ERR, "Failed to setsid: %m");
-                exit(-1);
+        if(daemonise(-1) == 0){
+        /*Detach into a daemon*/
+                failedShutdown();
         }
+        logStart();
+        /*From here on logging never blocks, it is written out by a thread*/
 
-        pid = fork();
-
-
-        if(pid < 0){
-                syslog(LOG_ERR, "Failed to fork: %m");
-                exit(-1);
-        }
-        if(pid>0){
-        /*If the fork was successful, exit cleanly*/
-                syslog(LOG_NOTICE, "Successfully forked second time\n");
-                exit(0);
-        }
-        if(chdir("/") < 0){
-        /*Change the working directory to root*/
-                syslog(LOG_ERR, "Failed to change to root: %m");
+        if(!catchStopSignals()){
+        /*Signal for closing application. systemctl stop sends SIGTERM, so the
+        * FIFO is removed then as well*/
+                LOGMSG(LOG_ERR, "Failed to catch signals: %m");
                 failedShutdown();
         }
-
-        /*Signal for closing application*/
-        signal(SIGQUIT, shutdown);
         /*Signal for if and when the pipe breaks*/
         signal(SIGPIPE, SIG_IGN);
 
-
-        umask(0);
-        close(STDIN_FILENO);
-        close(STDOUT_FILENO);
-        close(STDERR_FILENO);
-        /*close all IO files*/
-
-        for(int i= sysconf(_SC_OPEN_MAX); i>=0; i--){
-                close(i);
-        }
-        /*close any other open handles*/
-
         if(!PID_Lock("/var/run/CapsLockServer.pid", &g_pidfile)){
         /*if the PID file is failed to be created, then the daemon is already
         * running
         */
-                syslog(LOG_ERR, "Failure to create PID file: %m");
+                LOGMSG(LOG_ERR, "Failure to create PID file: %m");
                 failedShutdown();
 
         }
@@ -177,29 +152,89 @@ int main(void)
                 snprintf(toWrite, 20, "%d", getpid());
                 if(0 > write(g_pidfile, toWrite, strlen(toWrite))){
                 /*Write PID to PID file*/
-                        syslog(LOG_ERR, "Failed to write to PID file: %m");
+                        LOGMSG(LOG_ERR, "Failed to write to PID file: %m");
                         failedShutdown();
                 }
 
 
         }
 
+        applyRealtime();
+        lockMemory(NULL, 0);
+        /*Opt-in real-time scheduling, CPU pinning and memory locking*/
 
+        if(getConfigUInt("DINGER_JOURNAL", 1))
+        /*record every lock change in the flight recorder*/
+                journalOpen(&g_journal, "/var/run/CapsLockServer.journal",
+                                "server");
 
-	mkfifo(CAPS_FILE_DESC, 0666);
-	/*create the server-client FIFO pipe*/
-	syslog(LOG_NOTICE, "Waiting for connection...");
-	g_pipeLocation = open(CAPS_FILE_DESC, O_WRONLY);
-	/*Open the pipe and wait until there is a connection to it*/
-	if(g_pipeLocation <0){
-                syslog(LOG_ERR, "Failed to open Program File Descriptor: %m");
+
+
+        selectTransport(&g_channel, CAPS_FILE_DESC);
+        /*the FIFO, or the transport named in DINGER_TRANSPORT*/
+        const char* group = getenv("DINGER_GROUP");
+        if(group != NULL && *group != '\000'){
+        /*only let root and this group at the FIFO or socket*/
+                struct group* gr = getgrnam(group);
+                if(gr == NULL){
+                        LOGMSG(LOG_ERR, "Unknown group %s in DINGER_GROUP\n",
+                                group);
+                        failedShutdown();
+                }
+                g_channel.group = gr->gr_gid;
+        }
+	LOGMSG(LOG_NOTICE, "Waiting for connection over %s...",
+                g_channel.t->name);
+	if(!transportListen(&g_channel)){
+	/*create the server-client endpoint and wait until there is a connection
+	* to it*/
+                if(g_stopSignal)
+                        shutdownDaemon(g_stopSignal);
+                LOGMSG(LOG_ERR, "Failed to open Program File Descriptor: %m");
                 failedShutdown();
 	}
 
-        syslog(LOG_NOTICE, "Client was found!");
+        LOGMSG(LOG_NOTICE, "Client was found!");
+
+        g_loop.link = &g_channel;
+        g_loop.typewriter = getConfigUInt("DINGER_TYPEWRITER", 0);
+        /*send a click for every key press as well*/
+        if(g_loop.typewriter && g_channel.group == (gid_t)-1){
+        /*anyone who can read the endpoint would get the timing of every
+        * key press, so only send them to a group*/
+                LOGMSG(LOG_ALERT, "Typewriter mode needs DINGER_GROUP to "
+                        "restrict who can connect, it is off\n");
+                g_loop.typewriter = 0;
+        }
+        if(g_loop.typewriter)
+                LOGMSG(LOG_NOTICE,
+                        "Typewriter mode, clicking for key presses%s\n",
+                        g_loop.typewriter >= TYPEWRITER_REPEATS
+                                ? " and repeats" : "");
+        const char* input = getenv("DINGER_INPUT");
+        if(input != NULL && 0 == strcmp(input, "leds")){
+        /*watch the lock LEDs in sysfs instead of the keyboard, so the
+        * keyboard is never opened. If there are no lock LEDs, or the loop
+        * fails, read the keyboard after all*/
+                Led_Watch leds;
+                if(g_loop.typewriter)
+                        LOGMSG(LOG_ALERT, "The lock LEDs show no key presses, "
+                                "typewriter mode is off\n");
+                if(ledWatchInit(&leds)){
+                        ledLoop(&g_loop, &leds);
+                        ledWatchClose(&leds);
+                }
+                if(g_stopSignal)
+                        shutdownDaemon(g_stopSignal);
+                LOGMSG(LOG_ALERT, "Falling back to the keyboard event file\n");
+        }
 
         g_fd = getKeyboardInputDescriptor();
         /*obtain the keyboard event file descriptor*/
+        g_loop.in = g_fd;
+        g_loop.kernelClock = setEventClock(g_fd);
+        /*have the kernel timestamp the events so the client can tell how old
+        * they are*/
 
 
         /*Every time the OS updates the state of the lock key, it sends an
@@ -230,55 +265,22 @@ int main(void)
         *       [EV_LED] [LED_SCROLLL] [0]
         */
 
-        while(1){
-                struct input_event event;
-
-                Status_t status;
-                if(read(g_fd, &event, sizeof(struct input_event)) < 1){
-                /*Read an event */
-                        syslog(LOG_ERR, "Failed to read event file: %m");
-                        failedShutdown();
-
-                }
-                /*check if the event mathces one of the states where an LED
-                *changes
-                */
-                if(cmpEventVals(event, EV_LED, LED_CAPSL, HIGH)){
-                        status = CAPS_ON;
-                }
-                else if(cmpEventVals(event, EV_LED, LED_CAPSL, LOW)){
-                        status = CAPS_OFF;
-                }
-                else if(cmpEventVals(event, EV_LED, LED_NUML, HIGH)){
-                        status = NUM_ON;
-                }
-                else if(cmpEventVals(event, EV_LED, LED_NUML, LOW)){
-                        status = NUM_OFF;
-                }
-                else if(cmpEventVals(event, EV_LED, LED_SCROLLL, HIGH)){
-                        status = SCROLL_ON;
-                }
-                else if(cmpEventVals(event, EV_LED, LED_SCROLLL, LOW)){
-                        status = SCROLL_OFF;
-                }
-                else{
-                /*if no LED state is detected, then simply continue*/
-                        continue;
-                }
-                ///TODO: Need someone to check if scroll lock works, none of my
-                ///keyboards actually have a scroll lock key apparently
-                int rep = write(g_pipeLocation, &status, sizeof(Status_t));
-
-                if(rep == -1 && errno != EPIPE){
-                        /*if the write failed because the pipe is
-                        *broken, don't do anything, just scream into the
-                        *void. otherwise, display error and exit.
-                        */
-                        syslog(LOG_ERR, "Failed to write to pipe: %m");
-                        failedShutdown();
-                }
-
+        ///TODO: Need someone to check if scroll lock works, none of my
+        ///keyboards actually have a scroll lock key apparently
+        const char* io = getenv("DINGER_IO");
+        if(io != NULL && 0 == strcmp(io, "uring")){
+        /*the io_uring loop only returns if it is not available or fails, in
+        * which case the epoll loop takes over*/
+                uringLoop(&g_loop);
+                if(g_stopSignal)
+                        shutdownDaemon(g_stopSignal);
+                LOGMSG(LOG_ALERT, "Falling back to epoll: %m");
         }
+        epollLoop(&g_loop);
+        /*the loops only return on a failure or a signal to exit*/
+        if(g_stopSignal)
+                shutdownDaemon(g_stopSignal);
+        failedShutdown();
 
 
 	return 0;
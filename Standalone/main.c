@@ -0,0 +1,446 @@
+/***************************************************************************
+* File:  main.c
+* Author:  SkibbleBip
+* Single process build of the server and client for single user machines. It
+* reads the keyboard event file itself and plays the dings directly, with no
+* FIFO or second daemon in between.
+* Procedures:
+* getInputDescriptor    -Function that obtains the keyboard event file, either
+*                               handed in at launch or opened through group
+*                               permissions
+* dropPrivileges        -Function that switches from root to the user the
+*                               sounds are played for
+* shutdown              -Function that processes the shutdown procedures once
+*                               a signal to exit was caught
+* failedShutdown        -Function that concludes the shutdown procedures in the
+*                                event that an error were to occur
+* handleStatus          -Function that plays the ding of a lock change
+* main                  -The main function
+***************************************************************************/
+
+#define _GNU_SOURCE
+/*for the CPU affinity calls in Realtime.h*/
+
+#include <alsa/asoundlib.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <linux/input.h>//handle input events
+#include <linux/input-event-codes.h> //event codes
+#include <pwd.h>
+#include <grp.h>
+#include <poll.h>
+
+
+#include "../main.h"
+#include "../Server/Keyboard.h"
+#include "../Server/Scan.h"
+#include "../Client/Sound.h"
+#include "../Client/Playback.h"
+#include "../Realtime.h"
+#include "../Probes.h"
+#include "../Journal.h"
+
+#define         EVENT_BATCH     64
+/*Most input events read from the keyboard at once*/
+
+
+/*Global variables to handles and parameters*/
+int g_fd = -1;
+/*keyboard file descriptor*/
+int g_pidfile = -1;
+/*PID file descriptor*/
+char g_pidLocation[100];
+/*location of the PID file*/
+int g_lockState[TOGGLE_AXIS] = {-1, -1, -1};
+/*last known state of each lock, -1 if unknown*/
+int64_t g_maxAgeNs;
+/*lock changes older than this are not dinged for, 0 to ding for all*/
+uint g_staleDrops;
+/*how many lock changes were too old to ding for*/
+uint32_t g_seq;
+/*sequence number of the next lock change, for the probes*/
+Sound_Device *g_device = NULL;
+/*the output, for the shutdown handler*/
+
+/*Definitions of functions*/
+int getInputDescriptor(void);
+int dropPrivileges(void);
+void shutdown(int sig);
+void failedShutdown(void);
+void handleStatus(Status_t status, int64_t eventNs, Sound_Device *dev);
+
+int main(void);
+
+
+/***************************************************************************
+* int getInputDescriptor(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that obtains the keyboard event file. A launcher that
+*       holds the device can hand it in through DINGER_INPUT_FD, otherwise it
+*       is found and opened directly, which works as root or for a member of
+*       the input group
+*
+* Parameters:
+*        getInputDescriptor     O/P     int     The keyboard event file
+*                                               descriptor
+**************************************************************************/
+int getInputDescriptor(void)
+{
+        const char* handed = getenv("DINGER_INPUT_FD");
+        struct stat st;
+
+        if(handed == NULL || *handed == '\000')
+                return getKeyboardInputDescriptor();
+
+        int fd = atoi(handed);
+        if(fstat(fd, &st) < 0 || !S_ISCHR(st.st_mode)){
+        /*make sure what was handed in is actually a device*/
+                LOGMSG(LOG_ERR, "DINGER_INPUT_FD %s is not an input device\n",
+                        handed);
+                exit(-1);
+        }
+
+        LOGMSG(LOG_NOTICE, "Using keyboard handed in on descriptor %d\n", fd);
+        return fd;
+}
+
+/***************************************************************************
+* int dropPrivileges(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that switches to the user the sounds are played for
+*       when started as root, once the keyboard has been opened. The user is
+*       named by DINGER_USER, or taken from SUDO_UID. The user's supplementary
+*       groups are kept so it can still reach the audio devices.
+*
+* Parameters:
+*        dropPrivileges O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int dropPrivileges(void)
+{
+        if(geteuid() != 0)
+        /*already running as the user*/
+                return 1;
+
+        struct passwd *pwd = NULL;
+        const char* name = getenv("DINGER_USER");
+        const char* sudo = getenv("SUDO_UID");
+
+        if(name != NULL && *name != '\000')
+                pwd = getpwnam(name);
+        else if(sudo != NULL && *sudo != '\000')
+                pwd = getpwuid(atoi(sudo));
+
+        if(pwd == NULL || pwd->pw_uid == 0){
+                LOGMSG(LOG_ERR,
+                        "Refusing to play sounds as root, set DINGER_USER\n");
+                return 0;
+        }
+
+        if(initgroups(pwd->pw_name, pwd->pw_gid) < 0
+                || setgid(pwd->pw_gid) < 0
+                || setuid(pwd->pw_uid) < 0){
+                LOGMSG(LOG_ERR, "Failed to switch to %s: %m", pwd->pw_name);
+                return 0;
+        }
+        if(setuid(0) == 0){
+        /*make sure root can't be taken back*/
+                LOGMSG(LOG_ERR, "Failed to drop root privileges\n");
+                return 0;
+        }
+
+        char runtime[100];
+        snprintf(runtime, sizeof(runtime), "/run/user/%d", pwd->pw_uid);
+        if(setenv("XDG_RUNTIME_DIR", runtime, 1) < 0)
+        /*ALSA needs the runtime directory of the user, not of root*/
+                return 0;
+
+        LOGMSG(LOG_NOTICE, "Dropped privileges to %s\n", pwd->pw_name);
+        return 1;
+}
+
+/***************************************************************************
+* void shutdown(int sig)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Called from the main loop instead of the handler
+* Description: Function that processes the shutdown procedures once
+*       stopHandler has caught a signal to exit. It runs on the main loop,
+*       outside the handler, so it can log, drain and exit safely.
+*
+* Parameters:
+*        sig    I/P     int     Signal value
+**************************************************************************/
+void shutdown(int sig)
+{
+        LOGMSG(LOG_NOTICE, "Received signal %d to exit\n", sig);
+        close(g_fd);
+        close(g_pidfile);
+        /*close the keyboard and PID file (the pid file is unlocked on
+        * closing)*/
+        if(g_pcmHandle != NULL){
+                snd_pcm_drain(g_pcmHandle);
+                snd_pcm_close(g_pcmHandle);
+        }
+        /*drain and close the PCM handle*/
+        else if(g_device != NULL && g_device->sink != NULL)
+        /*or close whichever output was used instead*/
+                g_device->sink->close(g_device);
+
+        if(g_pidLocation[0] != '\000' && remove(g_pidLocation) != 0){
+                LOGMSG(LOG_ERR, "Failed to remove PID file: %m");
+        }
+
+	LOGMSG(LOG_NOTICE, "Closed. Goodbye!");
+	exit(0);
+}
+
+/***************************************************************************
+* void failedShutdown(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that concludes the shutdown procedures in the event
+*       that an error were to occur
+*
+* Parameters: N/A
+**************************************************************************/
+void failedShutdown(void)
+{
+        LOGMSG(LOG_CRIT, "Requesting shutdown due to failure\n");
+        close(g_fd);
+        close(g_pidfile);
+        if(g_pcmHandle != NULL)
+                snd_pcm_close(g_pcmHandle);
+
+        if(g_pidLocation[0] != '\000' && remove(g_pidLocation) != 0){
+                LOGMSG(LOG_ERR, "Failed to remove PID file: %m");
+        }
+        exit(-1);
+}
+
+/***************************************************************************
+* void handleStatus(Status_t status, int64_t eventNs, Sound_Device *dev)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that plays the ding or dong of a lock change, unless
+*       the lock is already known to be in that state or the change is too
+*       old to ding for
+*
+* Parameters:
+*        status  I/P    Status_t        The decoded lock change
+*        eventNs I/P    int64_t         When the kernel saw the change, in
+*                                       CLOCK_BOOTTIME nanoseconds
+*        dev     I/O    Sound_Device*   The struct of ALSA PCM handle and
+*                                       properties
+**************************************************************************/
+void handleStatus(Status_t status, int64_t eventNs, Sound_Device *dev)
+{
+        uint32_t seq = g_seq++;
+        int lock = status % TOGGLE_AXIS;
+        PROBE3(decode, seq, status, eventNs);
+        int on = status < TOGGLE_AXIS;
+        /*which lock changed and which way*/
+
+        Journal_Entry* e = journalNext(&g_journal, NULL);
+        if(e != NULL){
+                e->seq = seq;
+                e->status = status;
+                e->kernelNs = eventNs;
+                e->decodeNs = getBoottimeNs();
+                e->outcome = OUTCOME_UNCHANGED;
+        }
+
+        if(g_lockState[lock] == on)
+                return;
+        g_lockState[lock] = on;
+
+        int64_t age = getBoottimeNs() - eventNs;
+        if(g_maxAgeNs > 0 && age > g_maxAgeNs){
+        /*too old for the user to connect a ding to, only keep the state*/
+                g_staleDrops++;
+                if(e != NULL)
+                        e->outcome = OUTCOME_STALE;
+                LOGMSG(LOG_NOTICE, "Not dinging for a %lld ms old event "
+                        "(%u stale so far)\n", (long long)(age / 1000000),
+                        g_staleDrops);
+                return;
+        }
+
+        if(e != NULL){
+                e->playNs = getBoottimeNs();
+                e->outcome = OUTCOME_PLAYED;
+        }
+        if(on)
+                playSound(g_capsOnAsset.data, g_capsOnAsset.size, dev, seq);
+        else
+                playSound(g_capsOffAsset.data, g_capsOffAsset.size, dev, seq);
+
+        dev->sink->drain(dev);
+        /*Drain the pcm handle*/
+        PROBE2(drain_done, seq, getBoottimeNs());
+}
+
+/***************************************************************************
+* int main(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: The main function
+*
+* Parameters:
+*        main   O/P     int     The return value
+**************************************************************************/
+int main(void)
+{
+        Sound_Device device;
+        /*Struct of ALSA properties*/
+        memset(&device, 0, sizeof(device));
+
+        g_fd = getInputDescriptor();
+        /*obtain the keyboard event file while we may still have the rights
+        * to open it*/
+
+        if(daemonise(g_fd) == 0){
+        /*Detach into a daemon, keeping the keyboard open*/
+                failedShutdown();
+        }
+        logStart();
+        /*From here on logging never blocks, it is written out by a thread*/
+
+        applyRealtime();
+        /*Opt-in real-time scheduling and CPU pinning, applied before dropping
+        * root so the priority isn't limited by RLIMIT_RTPRIO*/
+
+        if(!dropPrivileges()){
+                failedShutdown();
+        }
+
+        if(!catchStopSignals()){
+        /*Signal for closing application*/
+                LOGMSG(LOG_ERR, "Failed to catch signals: %m");
+                failedShutdown();
+        }
+
+        snprintf(g_pidLocation, sizeof(g_pidLocation),
+                "/run/user/%d/CapsLockStandalone.pid", getuid());
+        if(!PID_Lock(g_pidLocation, &g_pidfile)){
+        /*if the PID file is failed to be created, then the daemon is already
+        * running
+        */
+                LOGMSG(LOG_ERR, "Failure to create PID file\n");
+                g_pidLocation[0] = '\000';
+                failedShutdown();
+        }
+        else{
+                char toWrite[20];
+                snprintf(toWrite, 20, "%d", getpid());
+                if(0 > write(g_pidfile, toWrite, strlen(toWrite))){
+                /*Write PID to PID file*/
+                        LOGMSG(LOG_ERR, "Failed to write to PID file: %m");
+                        failedShutdown();
+                }
+        }
+
+        if(getConfigUInt("DINGER_JOURNAL", 1)){
+        /*record every lock change in the flight recorder*/
+                char journal[100];
+                snprintf(journal, sizeof(journal),
+                        "/run/user/%d/CapsLockStandalone.journal", getuid());
+                journalOpen(&g_journal, journal, "standalone");
+        }
+
+        device.deviceName = getenv("DINGER_PCM_DEVICE");
+        if(device.deviceName == NULL || *device.deviceName == '\000')
+                device.deviceName = PCM_DEVICE;
+        device.periodTime = getConfigUInt("DINGER_PERIOD_US", PERIOD_TIME);
+        device.bufferTime = getConfigUInt("DINGER_BUFFER_US", BUFFER_TIME);
+        /*Obtain the target latency of the PCM device*/
+
+        selectOutput(&device);
+        g_device = &device;
+        if(device.sink->open(&device) == 0){
+        /*Set up the sound PCM device, or whichever output was chosen*/
+                LOGMSG(LOG_ERR, "Failed to set up sound devices: %m");
+                failedShutdown();
+        }
+        if(prepareAssets(&device) == 0){
+        /*Convert the sounds into the format the device negotiated*/
+                LOGMSG(LOG_ERR, "Failed to convert sounds");
+                failedShutdown();
+        }
+        const Memory_Region sounds[] = {
+                {g_capsOnAsset.data, g_capsOnAsset.size},
+                {g_capsOffAsset.data, g_capsOffAsset.size}
+        };
+        lockMemory(sounds, sizeof(sounds) / sizeof(sounds[0]));
+        /*Opt-in memory locking, once root is dropped and the output and the
+        * sounds it plays are set up*/
+
+        for(int i = 0; i < TOGGLE_AXIS; i++)
+        /*start from the current state of the locks*/
+                g_lockState[i] = readLedState(i);
+
+        int kernelClock = setEventClock(g_fd);
+        /*have the kernel timestamp the events so their age can be told*/
+        g_maxAgeNs = (int64_t)getConfigUInt("DINGER_MAX_AGE_MS", MAX_EVENT_AGE)
+                        * 1000000;
+
+        LOGMSG(LOG_NOTICE, "Standalone Caps Lock dinger running\n");
+
+        struct pollfd pfd[2] = {
+                {g_fd, POLLIN, 0},
+                {g_stopPipe[0], POLLIN, 0}
+        };
+        while(1){
+                if(poll(pfd, 2, -1) < 0 && errno != EINTR){
+                /*block until the keyboard has events, or a signal to exit is
+                * caught*/
+                        LOGMSG(LOG_ERR, "Failed to poll event file: %m");
+                        failedShutdown();
+                }
+                if(g_stopSignal)
+                        shutdown(g_stopSignal);
+                if(!(pfd[0].revents & (POLLIN|POLLERR|POLLHUP)))
+                        continue;
+
+                struct input_event events[EVENT_BATCH];
+                ssize_t size = read(g_fd, events, sizeof(events));
+                /*Read every event that is waiting at once*/
+                if(size < 0 && errno == EINTR)
+                        continue;
+                if(size < (ssize_t)sizeof(struct input_event)){
+                        LOGMSG(LOG_ERR, "Failed to read event file: %m");
+                        failedShutdown();
+                }
+
+                PROBE3(evdev_read, g_seq, size / sizeof(struct input_event),
+                        getBoottimeNs());
+                uint32_t found[EVENT_BATCH];
+                size_t matches = scanEvents(events,
+                                size / sizeof(struct input_event), found, 0);
+                /*only the LED and SYN_DROPPED events need decoding*/
+
+                for(size_t i = 0; i < matches; i++){
+                        const struct input_event* event = &events[found[i]];
+                        int64_t eventNs = kernelClock ? getEventNs(*event)
+                                                        : getBoottimeNs();
+                        Status_t status[TOGGLE_AXIS];
+
+                        if(event->type == EV_SYN){
+                        /*events were dropped, so catch up with where every
+                        * lock is now*/
+                                if(readDeviceLeds(g_fd, status)){
+                                        for(int j = 0; j < TOGGLE_AXIS; j++)
+                                                handleStatus(status[j], eventNs,
+                                                                &device);
+                                }
+                        }
+                        else if(decodeLedEvent(*event, &status[0]))
+                                handleStatus(status[0], eventNs, &device);
+                }
+        }
+
+
+	return 0;
+}
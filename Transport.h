@@ -0,0 +1,872 @@
+/***************************************************************************
+* File:  Transport.h
+* Author:  SkibbleBip
+* The ways the server can send lock changes to the client, chosen on the
+* server with DINGER_TRANSPORT:
+*
+*       fifo            the named FIFO at CAPS_FILE_DESC (the default)
+*       seqpacket       a unix SOCK_SEQPACKET connection, one packet per batch
+*       shm             a ring in shared memory, with an eventfd to wake the
+*                       client
+*       packet          a pipe in packet mode (pipe2 O_DIRECT)
+*
+* For all but the FIFO the server listens on a unix socket at the same path.
+* When a client connects, it is sent a hello naming the transport along with
+* any descriptors it needs (the pipe, or the shared memory and eventfd), so
+* the client follows whatever the server uses. The connection is kept to tell
+* when either side goes away, and a client that comes back simply connects
+* again.
+* Procedures:
+* fdSend                -Function that sends a batch with one write
+* fdReceive             -Function that reads a batch with one read
+* fdDrop                -Function that closes the descriptor of a client
+* seqpacketAttach       -Function that makes the connection itself the channel
+* seqpacketAdopt        -Function that makes the connection itself the channel
+* packetAttach          -Function that makes a packet pipe for a new client
+* packetAdopt           -Function that takes over the packet pipe
+* shmAttach             -Function that makes a shared ring for a new client
+* shmAdopt              -Function that maps the shared ring
+* shmSend               -Function that adds a batch to the shared ring
+* shmReceive            -Function that takes what is waiting in the shared
+*                               ring
+* shmDrop               -Function that unmaps the shared ring
+* sendHello             -Function that sends the hello and descriptors to a
+*                               new client
+* receiveHello          -Function that receives the hello and descriptors from
+*                               the server
+* selectTransport       -Function that picks the transport named in the
+*                               environment
+* transportAccept       -Function that accepts a client waiting on the socket
+* transportListen       -Function that creates the endpoint and waits for the
+*                               first client
+* transportConnect      -Function that connects to the server, whichever
+*                               transport it uses
+* transportSend         -Function that sends a batch of lock changes
+* transportClose        -Function that closes every descriptor of a channel
+***************************************************************************/
+
+#ifndef TRANSPORT_H_INCLUDED
+#define TRANSPORT_H_INCLUDED
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "main.h"
+
+#define         TRANSPORT_PACKET        128
+/*Most messages sent at once. A receiver must read this many at a time, as
+* the packet transports drop whatever part of a packet doesn't fit*/
+#define         SHM_SLOTS               256
+/*Messages the shared ring holds, must be a power of 2*/
+#define         HELLO_MAGIC             0x4c4c4548
+/*Marks the hello, "HELL" in little endian*/
+#define         MAX_HANDED              2
+/*Most descriptors handed to a client*/
+
+
+/*Kinds of transport, sent in the hello*/
+typedef enum {  TRANSPORT_FIFO,
+                TRANSPORT_SEQPACKET,
+                TRANSPORT_SHM,
+                TRANSPORT_PIPE
+        } Transport_Kind;
+
+/*Struct to contain the ring shared between the server and client. Only the
+* server moves the head and only the client moves the tail, each on its own
+* cache line*/
+typedef struct {
+        _Alignas(64) uint32_t head;
+        _Alignas(64) uint32_t tail;
+        _Alignas(64) Lock_Message slots[SHM_SLOTS];
+} Shm_Ring;
+
+/*Struct to contain the message the server sends a new client*/
+typedef struct {
+        uint32_t magic;
+        uint32_t kind;
+} Transport_Hello;
+
+typedef struct Transport Transport;
+
+/*Struct to contain one end of the link between the server and client*/
+typedef struct {
+        const Transport* t;
+        const char* path;
+        /*where the server listens*/
+        int fd;
+        /*the server writes to it and the client polls it, -1 while there is
+        * no client*/
+        int listenFd;
+        /*the server's socket that clients connect to, -1 for the FIFO*/
+        int peerFd;
+        /*the connection to the other side, -1 for the FIFO*/
+        int eventFd;
+        Shm_Ring* ring;
+        /*the shared memory transport's doorbell and ring*/
+        gid_t group;
+        /*the only group besides root let at the endpoint, (gid_t)-1 to let
+        * anyone at it*/
+} Channel;
+
+/*Struct to contain a transport. attach sets up the channel for a client that
+* has just connected and lists the descriptors to hand it; adopt takes them
+* over on the client. Both are NULL for the FIFO, which is opened by path and
+* never connected to. send returns whether the batch went, with errno EPIPE or
+* EAGAIN if there was no client to take it. receive never blocks; it returns
+* the number of messages read, 0 if the server has gone and -1 with errno
+* EAGAIN if there is nothing waiting*/
+struct Transport {
+        const char* name;
+        Transport_Kind kind;
+        int writable;
+        /*whether fd takes a batch as one write, so io_uring may send it*/
+        int (*attach)(Channel* c, int* fds, int* nfds);
+        int (*adopt)(Channel* c, int* fds, int nfds);
+        int (*send)(Channel* c, const Lock_Message* messages, uint count);
+        ssize_t (*receive)(Channel* c, Lock_Message* messages, uint count);
+        void (*drop)(Channel* c);
+};
+
+
+/***************************************************************************
+* int fdSend(Channel* c, const Lock_Message* messages, uint count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sends a batch with one write. A FIFO and a
+*       packet pipe keep a write up to PIPE_BUF in one piece, and a socket
+*       sends it as one packet, so the client never sees half of a message.
+*
+* Parameters:
+*        c              I/P     Channel*                The channel
+*        messages       I/P     const Lock_Message*     The messages
+*        count          I/P     uint                    Number of messages
+*        fdSend         O/P     int     Bool-type return value of whether
+*                                       the batch was sent
+**************************************************************************/
+int fdSend(Channel* c, const Lock_Message* messages, uint count)
+{
+        return write(c->fd, messages, count * sizeof(Lock_Message)) >= 0;
+}
+
+/***************************************************************************
+* ssize_t fdReceive(Channel* c, Lock_Message* messages, uint count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads what is waiting with one read
+*
+* Parameters:
+*        c              I/P     Channel*        The channel
+*        messages       I/O     Lock_Message*   Room for the messages
+*        count          I/P     uint            Most messages to read
+*        fdReceive      O/P     ssize_t         Messages read, 0 if the
+*                                               server has gone, or -1
+**************************************************************************/
+ssize_t fdReceive(Channel* c, Lock_Message* messages, uint count)
+{
+        ssize_t size = read(c->fd, messages, count * sizeof(Lock_Message));
+        return size < 0 ? -1 : size / (ssize_t)sizeof(Lock_Message);
+}
+
+/***************************************************************************
+* void fdDrop(Channel* c)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes the descriptor and connection of a client
+*
+* Parameters:
+*        c      I/O     Channel*        The channel
+**************************************************************************/
+void fdDrop(Channel* c)
+{
+        if(c->fd >= 0 && c->fd != c->peerFd)
+                close(c->fd);
+        if(c->peerFd >= 0)
+                close(c->peerFd);
+        c->fd = -1;
+        c->peerFd = -1;
+}
+
+/***************************************************************************
+* int seqpacketAttach(Channel* c, int* fds, int* nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that makes the connection of a new client the
+*       channel, so nothing is handed over
+*
+* Parameters:
+*        c                      I/O     Channel*        The channel
+*        fds                    I/O     int*            Unused
+*        nfds                   I/O     int*            Set to 0
+*        seqpacketAttach        O/P     int             Always 1
+**************************************************************************/
+int seqpacketAttach(Channel* c, int* fds, int* nfds)
+{
+        (void)fds;
+        c->fd = c->peerFd;
+        *nfds = 0;
+        return 1;
+}
+
+/***************************************************************************
+* int seqpacketAdopt(Channel* c, int* fds, int nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that makes the connection to the server the channel
+*
+* Parameters:
+*        c                      I/O     Channel*        The channel
+*        fds                    I/P     int*            Unused
+*        nfds                   I/P     int             Unused
+*        seqpacketAdopt         O/P     int             Always 1
+**************************************************************************/
+int seqpacketAdopt(Channel* c, int* fds, int nfds)
+{
+        (void)fds; (void)nfds;
+        c->fd = c->peerFd;
+        return 1;
+}
+
+/***************************************************************************
+* int packetAttach(Channel* c, int* fds, int* nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that makes a pipe in packet mode for a new client,
+*       where each write is read back whole by one read, and hands it the
+*       read end
+*
+* Parameters:
+*        c              I/O     Channel*        The channel
+*        fds            I/O     int*            The read end
+*        nfds           I/O     int*            Set to 1
+*        packetAttach   O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int packetAttach(Channel* c, int* fds, int* nfds)
+{
+        int p[2];
+
+        if(pipe2(p, O_DIRECT|O_CLOEXEC) < 0)
+        /*packet mode needs Linux 3.4*/
+                return 0;
+        c->fd = p[1];
+        fds[0] = p[0];
+        *nfds = 1;
+        return 1;
+}
+
+/***************************************************************************
+* int packetAdopt(Channel* c, int* fds, int nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that takes over the read end of the packet pipe
+*
+* Parameters:
+*        c              I/O     Channel*        The channel
+*        fds            I/P     int*            The read end
+*        nfds           I/P     int             Number of descriptors
+*        packetAdopt    O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int packetAdopt(Channel* c, int* fds, int nfds)
+{
+        if(nfds != 1){
+                errno = EPROTO;
+                return 0;
+        }
+        c->fd = fds[0];
+        return 1;
+}
+
+/***************************************************************************
+* int shmAttach(Channel* c, int* fds, int* nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that makes a ring in shared memory and an eventfd for
+*       a new client, and hands it both. Sending is then a copy and one write
+*       to the eventfd.
+*
+* Parameters:
+*        c              I/O     Channel*        The channel
+*        fds            I/O     int*            The memory and the eventfd
+*        nfds           I/O     int*            Set to 2
+*        shmAttach      O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int shmAttach(Channel* c, int* fds, int* nfds)
+{
+        int mem = memfd_create("dinger-ring", MFD_CLOEXEC);
+        if(mem < 0)
+                return 0;
+        if(ftruncate(mem, sizeof(Shm_Ring)) < 0){
+                close(mem);
+                return 0;
+        }
+        void* ring = mmap(NULL, sizeof(Shm_Ring), PROT_READ|PROT_WRITE,
+                                MAP_SHARED, mem, 0);
+        int ev = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if(ring == MAP_FAILED || ev < 0){
+                if(ring != MAP_FAILED)
+                        munmap(ring, sizeof(Shm_Ring));
+                if(ev >= 0)
+                        close(ev);
+                close(mem);
+                return 0;
+        }
+
+        c->ring = (Shm_Ring*)ring;
+        c->eventFd = ev;
+        c->fd = ev;
+        fds[0] = mem;
+        fds[1] = ev;
+        *nfds = 2;
+        return 1;
+}
+
+/***************************************************************************
+* int shmAdopt(Channel* c, int* fds, int nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that maps the shared ring. The client polls an epoll
+*       instance holding the eventfd and the connection, so it wakes both for
+*       messages and when the server goes away.
+*
+* Parameters:
+*        c              I/O     Channel*        The channel
+*        fds            I/P     int*            The memory and the eventfd
+*        nfds           I/P     int             Number of descriptors
+*        shmAdopt       O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int shmAdopt(Channel* c, int* fds, int nfds)
+{
+        struct epoll_event ev;
+
+        if(nfds != 2){
+                errno = EPROTO;
+                return 0;
+        }
+        void* ring = mmap(NULL, sizeof(Shm_Ring), PROT_READ|PROT_WRITE,
+                                MAP_SHARED, fds[0], 0);
+        close(fds[0]);
+        /*the mapping keeps the memory*/
+        c->eventFd = fds[1];
+        if(ring == MAP_FAILED)
+                return 0;
+        c->ring = (Shm_Ring*)ring;
+
+        c->fd = epoll_create1(EPOLL_CLOEXEC);
+        if(c->fd < 0)
+                return 0;
+        ev.events = EPOLLIN;
+        ev.data.fd = c->eventFd;
+        if(epoll_ctl(c->fd, EPOLL_CTL_ADD, c->eventFd, &ev) < 0)
+                return 0;
+        ev.events = EPOLLIN|EPOLLRDHUP;
+        ev.data.fd = c->peerFd;
+        return epoll_ctl(c->fd, EPOLL_CTL_ADD, c->peerFd, &ev) == 0;
+}
+
+/***************************************************************************
+* int shmSend(Channel* c, const Lock_Message* messages, uint count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that copies a batch into the shared ring, publishes
+*       it by moving the head, and rings the eventfd. If the ring has no room
+*       the client isn't reading, and the batch is not sent.
+*
+* Parameters:
+*        c              I/O     Channel*                The channel
+*        messages       I/P     const Lock_Message*     The messages
+*        count          I/P     uint                    Number of messages
+*        shmSend        O/P     int     Bool-type return value of whether
+*                                       the batch was sent
+**************************************************************************/
+int shmSend(Channel* c, const Lock_Message* messages, uint count)
+{
+        Shm_Ring* r = c->ring;
+        uint32_t head = r->head;
+        uint32_t used = head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+        if(used > SHM_SLOTS || SHM_SLOTS - used < count){
+        /*full, or the client wrote nonsense into the tail*/
+                errno = EAGAIN;
+                return 0;
+        }
+
+        for(uint i = 0; i < count; i++)
+                r->slots[(head + i) & (SHM_SLOTS - 1)] = messages[i];
+        __atomic_store_n(&r->head, head + count, __ATOMIC_RELEASE);
+
+        uint64_t one = 1;
+        return write(c->eventFd, &one, sizeof(one)) == sizeof(one);
+}
+
+/***************************************************************************
+* ssize_t shmReceive(Channel* c, Lock_Message* messages, uint count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that clears the eventfd and takes what is waiting in
+*       the shared ring. The eventfd is cleared first, so a batch published
+*       after the ring is read rings it again. Only when the ring is empty is
+*       the connection checked for the server having gone.
+*
+* Parameters:
+*        c              I/O     Channel*        The channel
+*        messages       I/O     Lock_Message*   Room for the messages
+*        count          I/P     uint            Most messages to take
+*        shmReceive     O/P     ssize_t         Messages taken, 0 if the
+*                                               server has gone, or -1
+**************************************************************************/
+ssize_t shmReceive(Channel* c, Lock_Message* messages, uint count)
+{
+        Shm_Ring* r = c->ring;
+        uint64_t rung;
+
+        (void)read(c->eventFd, &rung, sizeof(rung));
+
+        uint32_t tail = r->tail;
+        uint32_t ready = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - tail;
+        if(ready > SHM_SLOTS)
+                ready = SHM_SLOTS;
+        if(ready > count)
+                ready = count;
+        for(uint32_t i = 0; i < ready; i++)
+                messages[i] = r->slots[(tail + i) & (SHM_SLOTS - 1)];
+        __atomic_store_n(&r->tail, tail + ready, __ATOMIC_RELEASE);
+        if(ready > 0)
+                return ready;
+
+        char byte;
+        if(recv(c->peerFd, &byte, 1, MSG_DONTWAIT|MSG_PEEK) == 0)
+        /*the server closed the connection*/
+                return 0;
+        errno = EAGAIN;
+        return -1;
+}
+
+/***************************************************************************
+* void shmDrop(Channel* c)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that unmaps the shared ring and closes the eventfd,
+*       the epoll instance and the connection
+*
+* Parameters:
+*        c      I/O     Channel*        The channel
+**************************************************************************/
+void shmDrop(Channel* c)
+{
+        if(c->ring != NULL)
+                munmap(c->ring, sizeof(Shm_Ring));
+        if(c->eventFd >= 0 && c->eventFd != c->fd)
+                close(c->eventFd);
+        c->ring = NULL;
+        c->eventFd = -1;
+        fdDrop(c);
+}
+
+
+const Transport g_fifoTransport = {"fifo", TRANSPORT_FIFO, 1, NULL, NULL,
+                                fdSend, fdReceive, fdDrop};
+const Transport g_seqpacketTransport = {"seqpacket", TRANSPORT_SEQPACKET, 1,
+                                seqpacketAttach, seqpacketAdopt, fdSend,
+                                fdReceive, fdDrop};
+const Transport g_shmTransport = {"shm", TRANSPORT_SHM, 0, shmAttach,
+                                shmAdopt, shmSend, shmReceive, shmDrop};
+const Transport g_packetTransport = {"packet", TRANSPORT_PIPE, 1,
+                                packetAttach, packetAdopt, fdSend, fdReceive,
+                                fdDrop};
+
+const Transport* g_transports[] = {&g_fifoTransport, &g_seqpacketTransport,
+                                &g_shmTransport, &g_packetTransport};
+/*Every transport, indexed by kind*/
+
+
+/***************************************************************************
+* int sendHello(int sock, Transport_Kind kind, const int* fds, int nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sends the hello, with any descriptors to hand
+*       over attached to it
+*
+* Parameters:
+*        sock           I/P     int             The client's connection
+*        kind           I/P     Transport_Kind  The transport in use
+*        fds            I/P     const int*      The descriptors
+*        nfds           I/P     int             Number of descriptors
+*        sendHello      O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int sendHello(int sock, Transport_Kind kind, const int* fds, int nfds)
+{
+        Transport_Hello hello = {HELLO_MAGIC, kind};
+        struct iovec iov = {&hello, sizeof(hello)};
+        union {
+                char buf[CMSG_SPACE(MAX_HANDED * sizeof(int))];
+                struct cmsghdr align;
+        } control;
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        memset(&control, 0, sizeof(control));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if(nfds > 0){
+                msg.msg_control = control.buf;
+                msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+                struct cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+                cm->cmsg_level = SOL_SOCKET;
+                cm->cmsg_type = SCM_RIGHTS;
+                cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+                memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+        }
+
+        return sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(hello);
+}
+
+/***************************************************************************
+* int receiveHello(int sock, Transport_Hello* hello, int* fds, int* nfds)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that waits for the hello from the server and the
+*       descriptors attached to it
+*
+* Parameters:
+*        sock           I/P     int                     The connection
+*        hello          I/O     Transport_Hello*        The hello
+*        fds            I/O     int*            Room for MAX_HANDED
+*        nfds           I/O     int*            Number of descriptors
+*        receiveHello   O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int receiveHello(int sock, Transport_Hello* hello, int* fds, int* nfds)
+{
+        struct iovec iov = {hello, sizeof(*hello)};
+        union {
+                char buf[CMSG_SPACE(MAX_HANDED * sizeof(int))];
+                struct cmsghdr align;
+        } control;
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        *nfds = 0;
+
+        ssize_t size;
+        while((size = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+                ;
+        for(struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); size >= 0 && cm != NULL;
+                cm = CMSG_NXTHDR(&msg, cm)){
+                if(cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+                        continue;
+                *nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                memcpy(fds, CMSG_DATA(cm), *nfds * sizeof(int));
+        }
+
+        if(size != sizeof(*hello) || hello->magic != HELLO_MAGIC
+                || hello->kind >= sizeof(g_transports) / sizeof(g_transports[0])){
+                for(int i = 0; i < *nfds; i++)
+                        close(fds[i]);
+                if(size >= 0)
+                        errno = size == 0 ? ECONNRESET : EPROTO;
+                return 0;
+        }
+        return 1;
+}
+
+/***************************************************************************
+* void selectTransport(Channel* c, const char* path)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sets up an unconnected channel at a path, with
+*       the transport named in DINGER_TRANSPORT, or the FIFO if it is unset or
+*       unknown
+*
+* Parameters:
+*        c      I/O     Channel*        The channel
+*        path   I/P     const char*     Where the server listens
+**************************************************************************/
+void selectTransport(Channel* c, const char* path)
+{
+        const char* name = getenv("DINGER_TRANSPORT");
+
+        memset(c, 0, sizeof(*c));
+        c->t = &g_fifoTransport;
+        c->path = path;
+        c->fd = c->listenFd = c->peerFd = c->eventFd = -1;
+        c->group = (gid_t)-1;
+
+        if(name == NULL || *name == '\000')
+                return;
+        for(size_t i = 0; i < sizeof(g_transports) / sizeof(g_transports[0]); i++){
+                if(strcmp(name, g_transports[i]->name) == 0){
+                        c->t = g_transports[i];
+                        return;
+                }
+        }
+        LOGMSG(LOG_ALERT, "Unknown transport %s, using the FIFO\n", name);
+}
+
+/***************************************************************************
+* int transportAccept(Channel* c)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that accepts a client waiting on the socket, sets up
+*       its channel and sends it the hello. A client already connected is
+*       dropped, there is only ever one. If the transport can't be set up
+*       (ie packet pipes before Linux 3.4) the connection is used as a
+*       seqpacket channel instead.
+*
+* Parameters:
+*        c                      I/O     Channel*        The channel
+*        transportAccept        O/P     int     Bool-type return value of
+*                                               whether a client was accepted
+**************************************************************************/
+int transportAccept(Channel* c)
+{
+        int fds[MAX_HANDED];
+        int nfds = 0;
+
+        int sock = accept4(c->listenFd, NULL, NULL, SOCK_CLOEXEC);
+        if(sock < 0)
+                return 0;
+        if(c->fd >= 0 || c->peerFd >= 0)
+                c->t->drop(c);
+        c->peerFd = sock;
+
+        if(c->t->attach == NULL || !c->t->attach(c, fds, &nfds)){
+                LOGMSG(LOG_ALERT, "Failed to set up the %s transport, "
+                        "using seqpacket: %m", c->t->name);
+                c->t = &g_seqpacketTransport;
+                c->t->attach(c, fds, &nfds);
+        }
+        int ok = sendHello(sock, c->t->kind, fds, nfds);
+        for(int i = 0; i < nfds; i++){
+        /*the client has its own copies now*/
+                if(fds[i] != c->fd && fds[i] != c->eventFd)
+                        close(fds[i]);
+        }
+        if(!ok){
+                LOGMSG(LOG_ERR, "Failed to greet the client: %m");
+                c->t->drop(c);
+                return 0;
+        }
+
+        LOGMSG(LOG_NOTICE, "Client connected over %s\n", c->t->name);
+        return 1;
+}
+
+/***************************************************************************
+* int transportListen(Channel* c)
+* Author: SkibbleBip
+* Date: 10/19/2026      v1: Initial
+* Date: 10/19/2026      v2: Stops waiting on a signal to exit
+* Description: Function that creates the endpoint at the channel's path and
+*       blocks until the first client connects. The FIFO is opened for
+*       writing, which waits for a reader; anything else listens on a unix
+*       socket, which is then made non-blocking so later clients can be
+*       accepted from the event loop. With a group set, the endpoint is
+*       created 0660 and given to that group, so nobody else can read the
+*       FIFO or connect to the socket. A signal to exit stops the wait, with
+*       errno EINTR.
+*
+* Parameters:
+*        c                      I/O     Channel*        The channel
+*        transportListen        O/P     int     Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int transportListen(Channel* c)
+{
+        struct sockaddr_un addr;
+        struct pollfd pfd[2];
+
+        unlink(c->path);
+        /*remove whatever the last server left behind*/
+        mode_t mask = umask(c->group == (gid_t)-1 ? 0 : 0117);
+        /*created 0660 from the start, and root's group until the chown, so
+        * nobody else gets in before it*/
+        if(c->t->kind == TRANSPORT_FIFO){
+                int made = mkfifo(c->path, 0666) == 0;
+                umask(mask);
+                if(!made || (c->group != (gid_t)-1
+                                && chown(c->path, -1, c->group) < 0))
+                        return 0;
+                if(g_stopSignal){
+                        errno = EINTR;
+                        return 0;
+                }
+                c->fd = open(c->path, O_WRONLY|O_CLOEXEC);
+                /*a FIFO can't be polled for a reader, but the signal
+                * interrupts the open*/
+                return c->fd >= 0;
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, c->path, sizeof(addr.sun_path) - 1);
+        c->listenFd = socket(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0);
+        int bound = c->listenFd >= 0
+                && bind(c->listenFd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        umask(mask);
+        if(!bound || (c->group != (gid_t)-1
+                        && chown(c->path, -1, c->group) < 0)
+                || listen(c->listenFd, 4) < 0)
+                return 0;
+
+        pfd[0].fd = c->listenFd;
+        pfd[1].fd = g_stopPipe[0];
+        pfd[0].events = pfd[1].events = POLLIN;
+        while(1){
+        /*wait for the client, or for the stop pipe*/
+                if(poll(pfd, 2, -1) < 0 && errno != EINTR)
+                        return 0;
+                if(pfd[1].revents & POLLIN){
+                        errno = EINTR;
+                        return 0;
+                }
+                if(!(pfd[0].revents & POLLIN))
+                        continue;
+                if(transportAccept(c))
+                        break;
+                if(errno != EINTR && errno != ECONNABORTED && errno != EPIPE
+                        && errno != ECONNRESET)
+                        return 0;
+        }
+        return fcntl(c->listenFd, F_SETFL,
+                        fcntl(c->listenFd, F_GETFL) | O_NONBLOCK) == 0;
+}
+
+/***************************************************************************
+* int transportConnect(Channel* c, const char* path)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that connects to the server at a path, using the FIFO
+*       if that is what is there, and otherwise whichever transport the
+*       server's hello names. A socket blocks until the server is there. The
+*       FIFO is opened without waiting for a writer, since one left behind by
+*       a server that was killed never gets one; the caller has to watch the
+*       path for it being replaced. The channel is then non-blocking.
+*
+* Parameters:
+*        c                      I/O     Channel*        The channel
+*        path                   I/P     const char*     Where the server is
+*        transportConnect       O/P     int     Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int transportConnect(Channel* c, const char* path)
+{
+        struct stat st;
+        struct sockaddr_un addr;
+        Transport_Hello hello;
+        int fds[MAX_HANDED];
+        int nfds;
+
+        memset(c, 0, sizeof(*c));
+        c->t = &g_fifoTransport;
+        c->path = path;
+        c->fd = c->listenFd = c->peerFd = c->eventFd = -1;
+        c->group = (gid_t)-1;
+
+        if(stat(path, &st) < 0)
+                return 0;
+        if(S_ISFIFO(st.st_mode)){
+                c->fd = open(path, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+                /*the server's open for writing returns once this is open, and
+                * poll only wakes once it has written or gone away*/
+        }
+        else{
+                memset(&addr, 0, sizeof(addr));
+                addr.sun_family = AF_UNIX;
+                strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+                c->peerFd = socket(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0);
+                if(c->peerFd < 0
+                        || connect(c->peerFd, (struct sockaddr*)&addr,
+                                        sizeof(addr)) < 0
+                        || !receiveHello(c->peerFd, &hello, fds, &nfds)){
+                        int saved = errno;
+                        fdDrop(c);
+                        errno = saved;
+                        return 0;
+                }
+                c->t = g_transports[hello.kind];
+                if(c->t->adopt == NULL){
+                /*the FIFO is never handed over a socket*/
+                        for(int i = 0; i < nfds; i++)
+                                close(fds[i]);
+                        fdDrop(c);
+                        errno = EPROTO;
+                        return 0;
+                }
+                if(!c->t->adopt(c, fds, nfds)){
+                        int saved = errno;
+                        c->t->drop(c);
+                        errno = saved;
+                        return 0;
+                }
+        }
+
+        if(c->fd < 0)
+                return 0;
+        return fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK) == 0;
+}
+
+/***************************************************************************
+* int transportSend(Channel* c, const Lock_Message* messages, uint count)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that sends a batch of lock changes to the client. If
+*       the client of a socket transport has gone, its channel is dropped
+*       until the next one connects.
+*
+* Parameters:
+*        c              I/O     Channel*                The channel
+*        messages       I/P     const Lock_Message*     The messages
+*        count          I/P     uint                    Number of messages
+*        transportSend  O/P     int     Bool-type return value of whether
+*                                       the batch was sent, with errno EPIPE
+*                                       or EAGAIN if there was no client
+**************************************************************************/
+int transportSend(Channel* c, const Lock_Message* messages, uint count)
+{
+        if(c->fd < 0){
+                errno = EPIPE;
+                return 0;
+        }
+        if(c->t->send(c, messages, count))
+                return 1;
+        if(errno == ECONNRESET)
+                errno = EPIPE;
+        if(errno == EPIPE && c->listenFd >= 0)
+                c->t->drop(c);
+        return 0;
+}
+
+/***************************************************************************
+* void transportClose(Channel* c)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes every descriptor of a channel. It only
+*       closes and unmaps, so a signal handler may call it.
+*
+* Parameters:
+*        c      I/O     Channel*        The channel
+**************************************************************************/
+void transportClose(Channel* c)
+{
+        if(c->t != NULL)
+                c->t->drop(c);
+        if(c->listenFd >= 0)
+                close(c->listenFd);
+        c->listenFd = -1;
+}
+
+
+#endif // TRANSPORT_H_INCLUDED
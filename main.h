@@ -4,6 +4,19 @@
 * Procedures:
 * PID_Lock      -Function that attempts to lock a PID file and returns the
 *                       status of whether it was successful or not.
+* getConfigUInt -Function that reads an unsigned integer setting from the
+*                       environment, falling back to a default value
+* getMonotonicNs -Function that returns the monotonic clock in nanoseconds
+* getBoottimeNs -Function that returns the boot clock in nanoseconds
+* readLedState  -Function that reads the state of a lock LED from sysfs
+* closeFrom     -Function that closes every file descriptor from a number up,
+*                       except for one that is kept
+* daemonise     -Function that detaches the process into a daemon and reports
+*                       how long each step took
+* stopHandler   -Signal handler that records a signal to exit and wakes up
+*                       whatever the daemon is waiting on
+* catchStopSignals -Function that sets up the stop pipe and the handler for
+*                       the signals to exit
 ***************************************************************************/
 #include <signal.h>
 #include <syslog.h>
@@ -14,6 +27,15 @@
 #include <errno.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+
+#include "Log.h"
+/*LOGMSG, which every daemon logs through*/
 
 #ifndef MAIN_H_INCLUDED
 #define MAIN_H_INCLUDED
@@ -25,21 +47,56 @@ const char* CAPS_FILE_DESC = "/tmp/caps_lock";
 /*define the named FIFO that communicates server to client*/
 
 /*Defines the key status for the inputted key and the status its in
- (Currently only caps lock is in use)
+ (Currently only caps lock is in use). In typewriter mode the server also
+ sends a click for each key press, by the class of the key
  */
 typedef enum {  CAPS_ON,
                 NUM_ON,
                 SCROLL_ON,
                 CAPS_OFF,
                 NUM_OFF,
-                SCROLL_OFF
+                SCROLL_OFF,
+                CLICK_KEY,
+                CLICK_SPACE,
+                CLICK_ENTER,
+                CLICK_ERASE
         } Status_t;
 
+/*Struct to contain a lock change sent from the server to the client*/
+typedef struct {
+        uint32_t seq;
+        /*counts every message the server has sent*/
+        Status_t status;
+        int64_t kernelNs;
+        /*when the kernel saw the change, in CLOCK_BOOTTIME nanoseconds*/
+} Lock_Message;
+
+#define MAX_EVENT_AGE 500
+/*Default age in milliseconds after which a lock change is too old to ding
+* for (DINGER_MAX_AGE_MS)*/
+
 #define TOGGLE_AXIS 3
 /*when comparing if a key state has been set on or off, rather than doing
 * "if else if else" for key states for playing audible notes, one just needs
 * to check if state < TOGGLE_AXIS then play ding on, else play dong off*/
 
+#define CLICK_CLASSES 4
+/*number of click sounds, from CLICK_KEY on. Any status from CLICK_KEY up is a
+* key press rather than a lock change*/
+
+#define LED_CLASS_DIR "/sys/class/leds"
+/*directory the kernel exposes the keyboard LEDs in*/
+
+const char* g_ledNames[TOGGLE_AXIS] = {"capslock", "numlock", "scrolllock"};
+/*sysfs names of the lock LEDs, in the same order as Status_t*/
+
+volatile sig_atomic_t g_stopSignal = 0;
+/*the signal to exit that was caught, or 0. The daemon shuts down from its
+* main loop once it sees it, never from the handler*/
+int g_stopPipe[2] = {-1, -1};
+/*written to by the handler, so every wait that includes the read end wakes
+* up. It is never read, so it stays readable*/
+
 /***************************************************************************
 * int PID_Lock(char* path, int *pidfile)
 * Author: SkibbleBip
@@ -59,19 +116,328 @@ int PID_Lock(char* path, int *pidfile)
         /*Open the PID file*/
         if(*pidfile < 0){
         /*if failed to open, return with error*/
-                syslog(LOG_ERR, "Failed to open PID file %m");
+                LOGMSG(LOG_ERR, "Failed to open PID file %m");
                 return 0;
         }
         int lock = flock(*pidfile, LOCK_EX|LOCK_NB);
         /*Lock the PID file*/
         if(lock < 0){
         /*if the lock is negative, it's already locked*/
-                syslog(LOG_ERR, "PID is locked, Application is already running\n");
+                LOGMSG(LOG_ERR, "PID is locked, Application is already running\n");
                 return 0;
         }
         return 1;
 }
 
+/***************************************************************************
+* uint getConfigUInt(const char* name, uint def)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads an unsigned integer setting from the
+*               environment. If the variable is not set or is not a valid
+*               number, the default value is returned instead
+*
+* Parameters:
+*        name           I/P     const char*     Name of the environment variable
+*        def            I/P     uint            Default value of the setting
+*        getConfigUInt  O/P     uint            The value of the setting
+**************************************************************************/
+uint getConfigUInt(const char* name, uint def)
+{
+        const char* val = getenv(name);
+        /*obtain the setting from the environment*/
+        if(val == NULL || *val == '\000')
+                return def;
+
+        char* end;
+        unsigned long ret = strtoul(val, &end, 10);
+        if(*end != '\000'){
+        /*if the setting is not a number, ignore it*/
+                LOGMSG(LOG_ALERT, "Ignoring invalid value of %s: %s\n",
+                        name, val);
+                return def;
+        }
+        return (uint)ret;
+}
+
+
+/***************************************************************************
+* int64_t getMonotonicNs(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the time of the monotonic clock in
+*               nanoseconds, used for timing how long things take
+*
+* Parameters:
+*        getMonotonicNs O/P     int64_t The monotonic time in nanoseconds
+**************************************************************************/
+int64_t getMonotonicNs(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/***************************************************************************
+* int64_t getBoottimeNs(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that returns the time of the boot clock in
+*               nanoseconds. Unlike the monotonic clock it keeps counting
+*               while the machine is suspended, so it is used to tell how old
+*               an event is.
+*
+* Parameters:
+*        getBoottimeNs  O/P     int64_t The boot time in nanoseconds
+**************************************************************************/
+int64_t getBoottimeNs(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_BOOTTIME, &ts);
+        return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/***************************************************************************
+* int readLedState(int lock)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that reads the state of a lock LED from the LED class
+*               in sysfs, ie /sys/class/leds/input3::capslock/brightness. If
+*               there are several keyboards, the LED is on if any of them is.
+*
+* Parameters:
+*        lock           I/P     int     The lock to read (CAPS_ON, NUM_ON or
+*                                       SCROLL_ON)
+*        readLedState   O/P     int     1 if on, 0 if off and -1 if the LED
+*                                       could not be found
+**************************************************************************/
+int readLedState(int lock)
+{
+        DIR* dir = opendir(LED_CLASS_DIR);
+        struct dirent* entry;
+        char suffix[32];
+        int state = -1;
+
+        if(dir == NULL)
+                return -1;
+
+        snprintf(suffix, sizeof(suffix), "::%s", g_ledNames[lock]);
+
+        while((entry = readdir(dir)) != NULL){
+                size_t len = strlen(entry->d_name);
+                size_t sLen = strlen(suffix);
+                if(len < sLen || strcmp(entry->d_name + len - sLen, suffix) != 0)
+                /*not the LED we are looking for*/
+                        continue;
+
+                char path[300];
+                char value[16];
+                snprintf(path, sizeof(path), "%s/%s/brightness",
+                        LED_CLASS_DIR, entry->d_name);
+                int fd = open(path, O_RDONLY|O_CLOEXEC);
+                if(fd < 0)
+                        continue;
+                ssize_t n = read(fd, value, sizeof(value) - 1);
+                close(fd);
+                if(n <= 0)
+                        continue;
+                value[n] = '\000';
+
+                if(state < 1)
+                        state = atoi(value) > 0;
+        }
+
+        closedir(dir);
+        return state;
+}
+
+/***************************************************************************
+* const char* closeFrom(int lowfd, int keepFd)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that closes every file descriptor from lowfd up. The
+*               close_range syscall does it in one call; kernels without it
+*               have the open descriptors listed from /proc/self/fd, and only
+*               if that fails is every possible descriptor closed one by one,
+*               which can be over a million calls with a raised nofile limit
+*
+* Parameters:
+*        lowfd          I/P     int             The first descriptor to close
+*        keepFd         I/P     int             A descriptor to leave open, or
+*                                               -1 to close everything
+*        closeFrom      O/P     const char*     Name of the method that was used
+**************************************************************************/
+const char* closeFrom(int lowfd, int keepFd)
+{
+#ifdef SYS_close_range
+        if(keepFd < lowfd){
+                if(syscall(SYS_close_range, (unsigned int)lowfd, ~0U, 0) == 0)
+                        return "close_range";
+        }
+        else if((keepFd == lowfd
+                || syscall(SYS_close_range, (unsigned int)lowfd,
+                                (unsigned int)keepFd - 1, 0) == 0)
+                && syscall(SYS_close_range, (unsigned int)keepFd + 1, ~0U, 0) == 0){
+        /*close either side of the kept descriptor*/
+                return "close_range";
+        }
+#endif
+
+        DIR* dir = opendir("/proc/self/fd");
+        if(dir != NULL){
+                int self = dirfd(dir);
+                struct dirent* entry;
+                while((entry = readdir(dir)) != NULL){
+                /*close each descriptor that is actually open*/
+                        if(entry->d_name[0] < '0' || entry->d_name[0] > '9')
+                                continue;
+                        int fd = atoi(entry->d_name);
+                        if(fd >= lowfd && fd != self && fd != keepFd)
+                                close(fd);
+                }
+                closedir(dir);
+                return "/proc/self/fd";
+        }
+
+        for(int i= sysconf(_SC_OPEN_MAX); i>=lowfd; i--){
+        /*close any open handles*/
+                if(i != keepFd)
+                        close(i);
+        }
+        return "_SC_OPEN_MAX";
+}
+
+/***************************************************************************
+* int daemonise(int keepFd)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that forks twice into a new session, changes into the
+*               root directory, clears the umask and closes every handle. The
+*               time each step took is written to syslog so slow starts show
+*               up. Failing to fork exits straight away as nothing has been
+*               opened yet.
+*
+* Parameters:
+*        keepFd         I/P     int     A handle to keep open, ie one handed in
+*                                       at launch, or -1 to close them all
+*        daemonise      O/P     int     Bool-type return value of whether
+*                                       there was a failure
+**************************************************************************/
+int daemonise(int keepFd)
+{
+        int64_t start = getMonotonicNs();
+
+        pid_t pid = fork();
+        /*Fork the first time*/
+        if(pid < 0){
+                LOGMSG(LOG_ERR, "Failed to fork: %m");
+                exit(-1);
+                /*If there was a problem forking, then display error and exit*/
+        }
+        if(pid>0){
+                LOGMSG(LOG_NOTICE, "Successfully forked daemon\n");
+                exit(0);
+                /*sucessfully forked, we can now cleanly exit*/
+        }
+        int64_t forked = getMonotonicNs();
+
+        if(setsid() <0){
+                /*Otherwise, display error and exit*/
+                LOGMSG(LOG_ERR, "Failed to setsid: %m");
+                exit(-1);
+        }
+
+        pid = fork();
+        /*Fork second time*/
+        if(pid < 0){
+                LOGMSG(LOG_ERR, "Failed to fork: %m");
+                exit(-1);
+        }
+        if(pid>0){
+        /*If the fork was successful, exit cleanly*/
+                LOGMSG(LOG_NOTICE, "Successfully forked second time\n");
+                exit(0);
+        }
+        int64_t detached = getMonotonicNs();
+
+        if(chdir("/") < 0){
+        /*Change the working directory to root*/
+                LOGMSG(LOG_ERR, "Failed to change to root: %m");
+                return 0;
+        }
+        umask(0);
+
+        const char* method = closeFrom(0, keepFd);
+        /*close all IO files and any other open handles*/
+        int64_t closed = getMonotonicNs();
+
+        LOGMSG(LOG_NOTICE,
+                "Daemonised in %lld us (fork %lld us, setsid and fork %lld us, "
+                "closing handles %lld us via %s)\n",
+                (long long)((closed - start) / 1000),
+                (long long)((forked - start) / 1000),
+                (long long)((detached - forked) / 1000),
+                (long long)((closed - detached) / 1000),
+                method
+                );
+
+        return 1;
+}
+
+
+/***************************************************************************
+* void stopHandler(int sig)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Signal handler for the signals to exit. It only records the
+*       signal and writes to the stop pipe, which is all that is safe to do
+*       in a handler; the main loop logs and shuts down.
+*
+* Parameters:
+*        sig    I/P     int     Signal value
+**************************************************************************/
+void stopHandler(int sig)
+{
+        int saved = errno;
+
+        g_stopSignal = sig;
+        if(g_stopPipe[1] >= 0)
+                sig = write(g_stopPipe[1], "", 1);
+        /*if the pipe is full it is readable already*/
+        errno = saved;
+}
+
+/***************************************************************************
+* int catchStopSignals(void)
+* Author: SkibbleBip
+* Date: 10/19/2026
+* Description: Function that creates the stop pipe and installs stopHandler
+*       for SIGQUIT and SIGTERM. It has to be called after daemonising, which
+*       closes every handle. The handler doesn't restart system calls, so a
+*       blocking call that can't wait on the pipe returns EINTR instead.
+*
+* Parameters:
+*        catchStopSignals       O/P     int     Bool-type return value of
+*                                               whether there was a failure
+**************************************************************************/
+int catchStopSignals(void)
+{
+        struct sigaction action;
+
+        if(pipe(g_stopPipe) < 0)
+                return 0;
+        for(int i = 0; i < 2; i++){
+                fcntl(g_stopPipe[i], F_SETFD, FD_CLOEXEC);
+                fcntl(g_stopPipe[i], F_SETFL, O_NONBLOCK);
+        }
+
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = stopHandler;
+        sigemptyset(&action.sa_mask);
+        /*no SA_RESTART*/
+        return sigaction(SIGQUIT, &action, NULL) == 0
+                && sigaction(SIGTERM, &action, NULL) == 0;
+}
 
 
 #endif // MAIN_H_INCLUDED